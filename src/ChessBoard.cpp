@@ -51,7 +51,30 @@ void ChessBoard::makeZobristKey() {
     }
 
     updateZobristKey(SIDETOMOVE_IDX, chessboard[SIDETOMOVE_IDX]); //14
+    makePawnKey();
+    makeMaterialKey();
+}
 
+void ChessBoard::makeMaterialKey() {
+    materialKey = 0;
+    material[BLACK] = material[WHITE] = 0;
+    for (int u = 0; u < 12; u++) {
+        const int count = bitCount(chessboard[u]);
+        materialKey += min(count, MATERIAL_CAP[u]) * MATERIAL_WEIGHT[u] +
+                       max(0, count - MATERIAL_CAP[u]) * MATERIAL_OVERFLOW;
+        if (u != KING_BLACK && u != KING_WHITE) {
+            material[u & 1] += count * PIECES_VALUE[u];
+        }
+    }
+}
+
+void ChessBoard::makePawnKey() {
+    pawnKey = 0;
+    for (int u = PAWN_BLACK; u <= PAWN_WHITE; u++) {
+        for (u64 c = chessboard[u]; c; RESET_LSB(c)) {
+            updatePawnKey(u, BITScanForward(c));
+        }
+    }
 }
 
 const string ChessBoard::getFen() const {
@@ -334,6 +357,8 @@ int ChessBoard::loadFen(const string &fen) {
 
         }
     }
+    makePawnKey();
+    makeMaterialKey();
     chessboard[ENPASSANT_IDX] = NO_ENPASSANT;
     for (int i = 0; i < 64; i++) {
         if (enpassant == BOARD[i]) {
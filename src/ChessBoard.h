@@ -75,6 +75,9 @@ protected:
     Times *times = &Times::getInstance();
 #endif
     _Tchessboard chessboard;
+    u64 pawnKey;
+    u64 materialKey;
+    int material[2];
     int startPosWhiteKing;
     int startPosWhiteRookKingSide;
     int startPosWhiteRookQueenSide;
@@ -95,6 +98,53 @@ protected:
 
     void makeZobristKey();
 
+    void makePawnKey();
+
+    void makeMaterialKey();
+
+    // call after the piece is added, a count over MATERIAL_CAP moves the key past MATERIAL_OVERFLOW
+    void addMaterial(const int piece) {
+        ASSERT_RANGE(piece, 0, 11);
+        materialKey += piece <= PAWN_WHITE || bitCount(chessboard[piece]) <= MATERIAL_CAP[piece] ?
+                       MATERIAL_WEIGHT[piece] : MATERIAL_OVERFLOW;
+        material[piece & 1] += PIECES_VALUE[piece];
+    }
+
+    // call after the piece is removed
+    void removeMaterial(const int piece) {
+        ASSERT_RANGE(piece, 0, 11);
+        materialKey -= piece <= PAWN_WHITE || bitCount(chessboard[piece]) < MATERIAL_CAP[piece] ?
+                       MATERIAL_WEIGHT[piece] : MATERIAL_OVERFLOW;
+        material[piece & 1] -= PIECES_VALUE[piece];
+    }
+
+#if defined(DEBUG_MODE) || defined(FULL_TEST)
+
+    // incremental keys and material against a full recomputation
+    bool checkIncremental() {
+        const u64 oldPawnKey = pawnKey;
+        const u64 oldMaterialKey = materialKey;
+        const int oldMaterial[2] = {material[BLACK], material[WHITE]};
+        makePawnKey();
+        makeMaterialKey();
+        const bool res = oldPawnKey == pawnKey && oldMaterialKey == materialKey && oldMaterial[BLACK] == material[BLACK] &&
+                         oldMaterial[WHITE] == material[WHITE];
+        pawnKey = oldPawnKey;
+        materialKey = oldMaterialKey;
+        material[BLACK] = oldMaterial[BLACK];
+        material[WHITE] = oldMaterial[WHITE];
+        return res;
+    }
+
+#endif
+
+    // pawn-only zobrist key, used by the pawn hash in Eval
+    void updatePawnKey(const int piece, const int position) {
+        ASSERT_RANGE(piece, 0, 1);
+        ASSERT_RANGE(position, 0, 63);
+        pawnKey ^= _random::RANDOM_KEY[piece][position];
+    }
+
     void print(const _Tmove *move, const _Tchessboard &chessboard);
 
 #ifdef DEBUG_MODE
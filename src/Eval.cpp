@@ -19,89 +19,264 @@
 #include "Eval.h"
 
 using namespace _eval;
-u64 *Eval::evalHash;
+
+constexpr int Eval::KNOWN_WIN;
+constexpr int Eval::PHASE_MAX;
+Eval::_Tmaterial Eval::materialTable[MATERIAL_OVERFLOW];
+volatile bool Eval::materialGenerated = false;
+mutex Eval::mutexMaterial;
 
 Eval::Eval() {
-    if (evalHash == nullptr)
-        evalHash = (u64 *) calloc(hashSize, sizeof(u64));
+    initMaterialTable();
+    setEvalHashSize(EVAL_HASH_SIZE_DEFAULT);
+    pawnHash = (_TpawnEntry *) calloc(PAWN_HASH_SIZE, sizeof(_TpawnEntry));
+    if (!pawnHash) {
+        fatal("info string error - no memory");
+        exit(1);
+    }
+    // an empty board has pawnKey 0, don't let it match a zeroed entry
+    for (int i = 0; i < PAWN_HASH_SIZE; i++) {
+        pawnHash[i].key = ~0ULL;
+    }
 }
 
 Eval::~Eval() {
+#ifdef BENCH_MODE
+    if (sharedEvalHash) evalHash = nullptr;
+#endif
     free(evalHash);
     evalHash = nullptr;
+    free(pawnHash);
+    pawnHash = nullptr;
 }
 
 /**
- * evaluate pawns for color at phase
- * 1. if no pawns returns -NO_PAWNS
- * 3. if other side has all pawns substracts ENEMIES_ALL_PAWNS
- * 4. add ATTACK_KING * number of attacking pawn to other king
- * 5. space - in OPEN phase PAWN_CENTER * CENTER_MASK
- * 7. *king security* - in OPEN phase add at kingSecurity FRIEND_NEAR_KING * each pawn near to king and substracts ENEMY_NEAR_KING * each enemy pawn near to king
- * 8. pawn in 8th - if pawn is in 7' add PAWN_7H. If pawn can go forward add PAWN_IN_8TH for each pawn
- * 9. unprotected - no friends pawn protect it
- * 10. blocked - pawn can't go on
- * 11. isolated - there aren't friend pawns on the two sides - subtracts PAWN_ISOLATED for each pawn
- * 12. doubled - there aren't friend pawns on the two sides - subtracts DOUBLED_PAWNS for each pawn. If it is isolated too substracts DOUBLED_ISOLATED_PAWNS
- * 13. backward - if there isn't friend pawns on sides or on sides in 1 rank below subtracts BACKWARD_PAWN
- * 14. passed - if there isn't friend pawns forward and forward on sides until 8' rank add PAWN_PASSED[side][pos]
-
+ * material entry from the piece counts
+ * 1. phase from the pieces without pawns and kings: minor 1, rook 2, queen 4, PHASE_MAX with all of them
+ * 2. insufficient material - regexp: KN?B*KB* and KNNK
+ * 3. scaling - a side without pawns can't win with a minor piece or two knights, and hardly wins
+ *    with at most a bishop more than the other side
+ * 4. known endgames - KXK KBNK KQKR KRKB KRKN have their own evaluation
  */
-template<int side, Eval::_Tphase phase>
-int Eval::evaluatePawn() {
-    INC(evaluationCount[side]);
-    int result = 0;
-    constexpr int xside = side ^1;
+void Eval::setMaterial(const int count[12], _Tmaterial &entry) {
+    int npm[2];
+    for (int side = BLACK; side <= WHITE; side++) {
+        npm[side] = count[ROOK_BLACK + side] * VALUEROOK + count[BISHOP_BLACK + side] * VALUEBISHOP +
+                    count[KNIGHT_BLACK + side] * VALUEKNIGHT + count[QUEEN_BLACK + side] * VALUEQUEEN;
+    }
 
-    const u64 ped_friends = chessboard[side];
+    const int weight = count[BISHOP_BLACK] + count[BISHOP_WHITE] + count[KNIGHT_BLACK] + count[KNIGHT_WHITE] +
+                       2 * (count[ROOK_BLACK] + count[ROOK_WHITE]) + 4 * (count[QUEEN_BLACK] + count[QUEEN_WHITE]);
+    entry.phase = (uchar) min(weight, PHASE_MAX);
+
+    const int minors[2] = {count[BISHOP_BLACK] + count[KNIGHT_BLACK], count[BISHOP_WHITE] + count[KNIGHT_WHITE]};
+    entry.insufficient = false;
+    if (!(count[PAWN_BLACK] | count[PAWN_WHITE] | count[ROOK_BLACK] | count[ROOK_WHITE] | count[QUEEN_BLACK] |
+          count[QUEEN_WHITE])) {
+        const int totMinors = minors[BLACK] + minors[WHITE];
+        //KK KBK KNK
+        if (totMinors <= 1) entry.insufficient = true;
+            //KBKB KNKN KBKN KNNK
+        else if (totMinors == 2 && (minors[BLACK] == 1 || count[KNIGHT_BLACK] == 2 || count[KNIGHT_WHITE] == 2))
+            entry.insufficient = true;
+    }
 
-    // 5. space
-    if (phase == OPEN) {
-        result += PAWN_CENTER * bitCount(ped_friends & CENTER_MASK);
-        ADD(SCORE_DEBUG.PAWN_CENTER[side], PAWN_CENTER * bitCount(ped_friends & CENTER_MASK));
+    // 4. known endgames
+    entry.endgame = ENDGAME_NONE;
+    entry.strongSide = WHITE;
+    for (int strong = BLACK; strong <= WHITE; strong++) {
+        const int weak = strong ^ 1;
+        const int strongPieces = count[ROOK_BLACK + strong] + count[BISHOP_BLACK + strong] +
+                                 count[KNIGHT_BLACK + strong] + count[QUEEN_BLACK + strong];
+        const int weakPieces = count[ROOK_BLACK + weak] + count[BISHOP_BLACK + weak] + count[KNIGHT_BLACK + weak] +
+                               count[QUEEN_BLACK + weak];
+        const bool pawns = count[PAWN_BLACK] || count[PAWN_WHITE];
+        if (!weakPieces && !count[PAWN_BLACK + weak]) {
+            if (count[ROOK_BLACK + strong] || count[QUEEN_BLACK + strong]) {
+                entry.endgame = ENDGAME_KXK;
+            } else if (!pawns && strongPieces == 2 && count[BISHOP_BLACK + strong] == 1 &&
+                       count[KNIGHT_BLACK + strong] == 1) {
+                entry.endgame = ENDGAME_KBNK;
+            }
+        } else if (!pawns && strongPieces == 1 && weakPieces == 1) {
+            if (count[QUEEN_BLACK + strong] && count[ROOK_BLACK + weak]) {
+                entry.endgame = ENDGAME_KQKR;
+            } else if (count[ROOK_BLACK + strong] && (count[BISHOP_BLACK + weak] || count[KNIGHT_BLACK + weak])) {
+                entry.endgame = ENDGAME_KRKM;
+            }
+        }
+        if (entry.endgame != ENDGAME_NONE) {
+            entry.strongSide = (uchar) strong;
+            break;
+        }
     }
 
-    // 7.
-    if (phase != OPEN) {
-        structureEval.kingSecurity[side] +=
-                FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & ped_friends);
+    for (int side = BLACK; side <= WHITE; side++) {
+        entry.scale[side] = SCALE_NORMAL;
+        if (!count[PAWN_BLACK + side]) {
+            if (npm[side] < VALUEROOK || (npm[side] == 2 * VALUEKNIGHT && count[KNIGHT_BLACK + side] == 2)) {
+                //a minor piece or two knights
+                entry.scale[side] = 0;
+            } else if (npm[side] - npm[side ^ 1] <= VALUEBISHOP) {
+                entry.scale[side] = npm[side ^ 1] <= VALUEBISHOP ? 4 : 14;
+            }
+        }
+    }
+}
 
-        structureEval.kingSecurity[side] -=
-                ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & ped_friends);
+const Eval::_TendgameFn Eval::ENDGAMES[ENDGAME_N][2] = {
+        {nullptr,                       nullptr},
+        {&Eval::evaluateKXK<BLACK>,  &Eval::evaluateKXK<WHITE>},
+        {&Eval::evaluateKBNK<BLACK>, &Eval::evaluateKBNK<WHITE>},
+        {&Eval::evaluateKQKR<BLACK>, &Eval::evaluateKQKR<WHITE>},
+        {&Eval::evaluateKRKM<BLACK>, &Eval::evaluateKRKM<WHITE>}};
+
+/**
+ * lone king against rook or queen (pawns and other pieces allowed): push the king to the edge
+ */
+template<int strong>
+int Eval::evaluateKXK() const {
+    constexpr int weak = strong ^1;
+    const int strongKing = BITScanForward(chessboard[KING_BLACK + strong]);
+    const int weakKing = BITScanForward(chessboard[KING_BLACK + weak]);
+    return KNOWN_WIN + material[strong] + PUSH_TO_EDGE * centerDistance(weakKing) +
+           PUSH_CLOSE * (7 - distance(strongKing, weakKing));
+}
+
+/**
+ * bishop and knight: push the king to a corner of the color of the bishop
+ */
+template<int strong>
+int Eval::evaluateKBNK() const {
+    constexpr int weak = strong ^1;
+    const int strongKing = BITScanForward(chessboard[KING_BLACK + strong]);
+    const int weakKing = BITScanForward(chessboard[KING_BLACK + weak]);
+    const u64 bishopColor = board::colors(BITScanForward(chessboard[BISHOP_BLACK + strong]));
+    int cornerDistance = 7;
+    for (const int corner:{0, 7, 56, 63}) {
+        if (POW2[corner] & bishopColor) {
+            cornerDistance = min(cornerDistance, distance(corner, weakKing));
+        }
     }
+    return KNOWN_WIN + material[strong] + PUSH_TO_CORNER * (7 - cornerDistance) +
+           PUSH_CLOSE * (7 - distance(strongKing, weakKing));
+}
 
-    // 8.  pawn in 8th
-    if (phase != OPEN) {
-        const u64 pawnsIn7 = PAWNS_7_2[side] & ped_friends;
-        result += PAWN_IN_7TH * bitCount(pawnsIn7);
-        ADD(SCORE_DEBUG.PAWN_7H[side], PAWN_IN_7TH * bitCount(pawnsIn7));
+/**
+ * queen against rook: won, push the king to the edge
+ */
+template<int strong>
+int Eval::evaluateKQKR() const {
+    constexpr int weak = strong ^1;
+    const int strongKing = BITScanForward(chessboard[KING_BLACK + strong]);
+    const int weakKing = BITScanForward(chessboard[KING_BLACK + weak]);
+    return VALUEQUEEN - VALUEROOK + PUSH_TO_EDGE * centerDistance(weakKing) +
+           PUSH_CLOSE * (7 - distance(strongKing, weakKing));
+}
 
-        const u64 pawnsIn8 = (shiftForward<side, 8>(pawnsIn7) & (~structureEval.allPieces)) |
-                             (structureEval.allPiecesSide[xside] &
-                              (shiftForward<side, 7>(pawnsIn7) | shiftForward<side, 9>(pawnsIn7)));
+/**
+ * rook against a minor piece: drawish, small bonus for the rook growing if the king is on the edge or far
+ * from its knight
+ */
+template<int strong>
+int Eval::evaluateKRKM() const {
+    constexpr int weak = strong ^1;
+    const int weakKing = BITScanForward(chessboard[KING_BLACK + weak]);
+    int result = VALUEPAWN / 4 + PUSH_TO_EDGE / 4 * centerDistance(weakKing);
+    if (chessboard[KNIGHT_BLACK + weak]) {
+        result += PUSH_CLOSE / 2 * distance(weakKing, BITScanForward(chessboard[KNIGHT_BLACK + weak]));
+    }
+    return result;
+}
+
+void Eval::initMaterialTable() {
+    std::lock_guard<std::mutex> lock(mutexMaterial);
+    if (materialGenerated) {
+        return;
+    }
+    for (u64 key = 0; key < MATERIAL_OVERFLOW; key++) {
+        int count[12] = {0};
+        for (int side = BLACK; side <= WHITE; side++) {
+            int k = (int) (side == WHITE ? key / MATERIAL_SIDE : key % MATERIAL_SIDE);
+            for (const int piece:{PAWN_BLACK, ROOK_BLACK, BISHOP_BLACK, KNIGHT_BLACK, QUEEN_BLACK}) {
+                count[piece + side] = k % (MATERIAL_CAP[piece] + 1);
+                k /= MATERIAL_CAP[piece] + 1;
+            }
+        }
+        setMaterial(count, materialTable[key]);
+    }
+    materialGenerated = true;
+}
 
-        result += PAWN_IN_8TH * bitCount(pawnsIn8); //try to decrease PAWN_IN_8TH
-        ADD(SCORE_DEBUG.PAWN_IN_8TH[side], PAWN_IN_8TH * (bitCount(pawnsIn8)));
+const Eval::_Tmaterial &Eval::getMaterialOverflow() {
+    int count[12];
+    for (int piece = 0; piece < 12; piece++) {
+        count[piece] = bitCount(chessboard[piece]);
+    }
+    setMaterial(count, materialOverflow);
+    return materialOverflow;
+}
 
+void Eval::setEvalHashSize(const int mb) {
+    u64 n = 1;
+    while (n * 2 * sizeof(u64) <= (u64) max(1, mb) * 1024 * 1024) {
+        n *= 2;
+    }
+#ifdef BENCH_MODE
+    if (sharedEvalHash) {
+        evalHash = nullptr;
+        sharedEvalHash = false;
     }
+#endif
+    free(evalHash);
+    evalHash = (u64 *) calloc(n, sizeof(u64));
+    if (!evalHash) {
+        fatal("info string error - no memory");
+        exit(1);
+    }
+    evalHashMask = n - 1;
+}
+
+void Eval::clearEvalHash() {
+    memset(evalHash, 0, (evalHashMask + 1) * sizeof(u64));
+}
+
+#ifdef BENCH_MODE
+
+void Eval::shareEvalHash(const Eval &owner) {
+    if (!sharedEvalHash) free(evalHash);
+    evalHash = owner.evalHash;
+    evalHashMask = owner.evalHashMask;
+    sharedEvalHash = true;
+}
+
+#endif
+
+/**
+ * pawn structure for color, depends only on the pawns and is stored in the pawn hash
+ * 9. unprotected - no friends pawn protect it
+ * 11. isolated - there aren't friend pawns on the two sides - subtracts PAWN_ISOLATED for each pawn
+ * 12. doubled - there aren't friend pawns on the two sides - subtracts DOUBLED_PAWNS for each pawn. If it is isolated too substracts DOUBLED_ISOLATED_PAWNS
+ * 13. backward - if there isn't friend pawns on sides or on sides in 1 rank below subtracts BACKWARD_PAWN
+ * 14. passed - if there isn't friend pawns forward and forward on sides until 8' rank add PAWN_PASSED[side][pos]
+ * also the pawns in center and in 7th, passed pawns, pawn attacks and files without friend pawns
+ */
+template<int side>
+void Eval::evaluatePawnStructure(_TpawnEntry &entry) {
+    constexpr int xside = side ^1;
+    const u64 ped_friends = chessboard[side];
+    int result = 0;
+    entry.passed[side] = entry.attacks[side] = 0;
+    entry.openFiles[side] = 0xffffffffffffffffULL;
+    entry.center[side] = (uchar) bitCount(ped_friends & CENTER_MASK);
+    entry.in7[side] = (uchar) bitCount(PAWNS_7_2[side] & ped_friends);
 
     for (u64 p = ped_friends; p; RESET_LSB(p)) {
         bool isolated = false;
         const int o = BITScanForward(p);
-        u64 pos = POW2[o];
+        entry.attacks[side] |= PAWN_FORK_MASK[side][o];
+        entry.openFiles[side] &= ~FILE_[o];
 
-        // 4. attack king
-        if (structureEval.posKingBit[xside] & PAWN_FORK_MASK[side][o]) {
-            structureEval.kingAttackers[xside] |= pos;
-            result += ATTACK_KING;
-        }
-
-        /// blocked
-        result -= (!(PAWN_FORK_MASK[side][o] & structureEval.allPiecesSide[xside])) &&
-                  (structureEval.allPieces & (shiftForward<side, 8>(pos))) ? PAWN_BLOCKED : 0;
-        ADD(SCORE_DEBUG.PAWN_BLOCKED[side], (!(PAWN_FORK_MASK[side][o] & structureEval.allPiecesSide[xside])) &&
-                                            (structureEval.allPieces & (shiftForward<side, 8>(pos))) ? -PAWN_BLOCKED
-                                                                                                     : 0);
         /// unprotected
         if (!(ped_friends & PAWN_PROTECTED_MASK[side][o])) {
             result -= UNPROTECTED_PAWNS;
@@ -132,23 +307,166 @@ int Eval::evaluatePawn() {
         if (!(chessboard[xside] & PAWN_PASSED_MASK[side][o])) {
             ADD(SCORE_DEBUG.PAWN_PASSED[side], PAWN_PASSED[side][o]);
             result += PAWN_PASSED[side][o];
+            entry.passed[side] |= POW2[o];
         }
     }
+    entry.structure[side] = (short) result;
+}
+
+/**
+ * complete the attack maps left by the piece evaluation with pawns and kings,
+ * move generation reads them while the position doesn't change
+ */
+void Eval::setAttackMap() {
+    for (int side = BLACK; side <= WHITE; side++) {
+        structureEval.attacksByPiece[PAWN_BLACK + side] = pawnEntry->attacks[side];
+        structureEval.attacksByPiece[KING_BLACK + side] = NEAR_MASK1[structureEval.posKing[side]];
+        structureEval.attacksBySide[side] =
+                structureEval.attacksByPiece[PAWN_BLACK + side] | structureEval.attacksByPiece[ROOK_BLACK + side] |
+                structureEval.attacksByPiece[BISHOP_BLACK + side] | structureEval.attacksByPiece[KNIGHT_BLACK + side] |
+                structureEval.attacksByPiece[KING_BLACK + side] | structureEval.attacksByPiece[QUEEN_BLACK + side];
+    }
+    structureEval.attackKey = chessboard[ZOBRISTKEY_IDX];
+}
+
+const Eval::_TpawnEntry *Eval::probePawnHash(const bool trace) {
+    _TpawnEntry *entry = &pawnHash[pawnKey & (PAWN_HASH_SIZE - 1)];
+    STATS(nPawnHashProbe++)
+    // trace always recomputes to fill SCORE_DEBUG
+    if (entry->key == pawnKey && !trace) {
+        STATS(nPawnHashHit++)
+        return entry;
+    }
+    evaluatePawnStructure<BLACK>(*entry);
+    evaluatePawnStructure<WHITE>(*entry);
+    entry->key = pawnKey;
+    return entry;
+}
+
+/**
+ * evaluate pawns for color, the result is a mid/end game pair
+ * 1. if no pawns returns -NO_PAWNS
+ * 3. if other side has all pawns substracts ENEMIES_ALL_PAWNS
+ * 4. add ATTACK_KING * number of attacking pawn to other king
+ * 5. space - in middle game PAWN_CENTER * CENTER_MASK
+ * 7. *king security* - add at kingSecurity FRIEND_NEAR_KING * each pawn near to king and substracts ENEMY_NEAR_KING * each enemy pawn near to king
+ * 8. pawn in 8th - if pawn is in 7' add PAWN_7H. If pawn can go forward add PAWN_IN_8TH for each pawn
+ * 10. blocked - pawn can't go on
+ * 9., 11.-14. see evaluatePawnStructure
+ */
+template<int side>
+int Eval::evaluatePawn() {
+    INC(evaluationCount[side]);
+    int result = pawnEntry->structure[side];
+    constexpr int xside = side ^1;
+
+    const u64 ped_friends = chessboard[side];
+
+    // 5. space
+    result += S(PAWN_CENTER * pawnEntry->center[side], 0);
+    ADD(SCORE_DEBUG.PAWN_CENTER[side], taper(S(PAWN_CENTER * pawnEntry->center[side], 0)));
+
+    // 7.
+    structureEval.kingSecurity[side] +=
+            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & ped_friends);
+
+    structureEval.kingSecurity[side] -=
+            ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & ped_friends);
+
+    // 8.  pawn in 8th
+    const u64 pawnsIn7 = PAWNS_7_2[side] & ped_friends;
+    result += PAWN_IN_7TH * pawnEntry->in7[side];
+    ADD(SCORE_DEBUG.PAWN_7H[side], PAWN_IN_7TH * pawnEntry->in7[side]);
+
+    const u64 pawnsIn8 = (shiftForward<side, 8>(pawnsIn7) & (~structureEval.allPieces)) |
+                         (structureEval.allPiecesSide[xside] &
+                          (shiftForward<side, 7>(pawnsIn7) | shiftForward<side, 9>(pawnsIn7)));
+
+    result += PAWN_IN_8TH * bitCount(pawnsIn8); //try to decrease PAWN_IN_8TH
+    ADD(SCORE_DEBUG.PAWN_IN_8TH[side], PAWN_IN_8TH * (bitCount(pawnsIn8)));
+
+    // 4. attack king
+    if (structureEval.posKingBit[xside] & pawnEntry->attacks[side]) {
+        for (u64 p = ped_friends; p; RESET_LSB(p)) {
+            const int o = BITScanForward(p);
+            if (structureEval.posKingBit[xside] & PAWN_FORK_MASK[side][o]) {
+                structureEval.kingAttackers[xside] |= POW2[o];
+                result += ATTACK_KING;
+            }
+        }
+    }
+
+    /// blocked
+    for (u64 p = ped_friends & shiftForward<xside, 8>(structureEval.allPieces); p; RESET_LSB(p)) {
+        const int o = BITScanForward(p);
+        if (!(PAWN_FORK_MASK[side][o] & structureEval.allPiecesSide[xside])) {
+            result -= PAWN_BLOCKED;
+            ADD(SCORE_DEBUG.PAWN_BLOCKED[side], -PAWN_BLOCKED);
+        }
+    }
+    return result;
+}
+
+/**
+ * outposts of all the pieces of a type at once: squares defended by a friend pawn and not in the
+ * attack span of the enemy pawns get table[square], twice if the enemy has no knights and no bishop
+ * on that color
+ */
+template<int side>
+int Eval::evaluateOutposts(const int *table, const u64 pieces) const {
+    constexpr int xside = side ^1;
+    const u64 outposts = pieces & pawnEntry->attacks[side] & ~board::getPawnAttacks<side>(chessboard[xside]);
+    if (!outposts) return 0;
+    int result = tableSum(table, outposts);
+    if (!chessboard[KNIGHT_BLACK + xside]) {
+        result += tableSum(table, outposts & board::getNoBishopColors(chessboard[BISHOP_BLACK + xside]));
+    }
     return result;
 }
 
+int Eval::tableSum(const int *table, const u64 bits) {
+#if defined(__AVX2__)
+    const __m256i mask = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < 64; i += 8) {
+        const int byte = (int) ((bits >> i) & 0xff);
+        if (!byte) continue;
+        const __m256i selected = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), mask), mask);
+        sum = _mm256_add_epi32(sum, _mm256_and_si256(selected, _mm256_loadu_si256((const __m256i *) (table + i))));
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return _mm_cvtsi128_si32(s);
+#elif defined(__SSE4_2__)
+    const __m128i mask = _mm_setr_epi32(1, 2, 4, 8);
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < 64; i += 4) {
+        const int nibble = (int) ((bits >> i) & 0xf);
+        if (!nibble) continue;
+        const __m128i selected = _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(nibble), mask), mask);
+        sum = _mm_add_epi32(sum, _mm_and_si128(selected, _mm_loadu_si128((const __m128i *) (table + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return _mm_cvtsi128_si32(sum);
+#else
+    return tableSumScalar(table, bits);
+#endif
+}
+
 /**
- * evaluate bishop for color at phase
+ * evaluate bishop for color, the result is a mid/end game pair
  * 1. if no bishops returns 0
  * 2. if two bishops add BONUS2BISHOP
- * 3 *king security* - in OPEN phase substracts at kingSecurity ENEMY_NEAR_KING for each bishop close to enmey king
- * 4. undevelop - substracts UNDEVELOPED_BISHOP for each undeveloped bishop
- * 5. mobility add MOB_BISHOP[phase][???]
+ * 3 *king security* - substracts at kingSecurity ENEMY_NEAR_KING for each bishop close to enmey king
+ * 4. undevelop - in middle game substracts UNDEVELOPED_BISHOP for each undeveloped bishop
+ * 5. mobility add MOB_BISHOP[???]
  * 6. if only one bishop and pawns on same square color substracts n_pawns * BISHOP_PAWN_ON_SAME_COLOR
  * 7. outposts
  * 8. bishop on big diagonal
  */
-template<int side, Eval::_Tphase phase>
+template<int side>
 int Eval::evaluateBishop(const u64 enemies) {
     INC(evaluationCount[side]);
     constexpr int xside = side ^1;
@@ -166,110 +484,95 @@ int Eval::evaluateBishop(const u64 enemies) {
     } else {
         // 2.
         ASSERT(nBishop > 1)
-        if (phase != OPEN) {
-            result += BONUS2BISHOP;
-            ADD(SCORE_DEBUG.BONUS2BISHOP[side], BONUS2BISHOP);
-        }
+        result += BONUS2BISHOP;
+        ADD(SCORE_DEBUG.BONUS2BISHOP[side], BONUS2BISHOP);
     }
 
     // 3. *king security*
-    if (phase != OPEN) {
-        structureEval.kingSecurity[side] -=
-                ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & bishop);
-        ADD(SCORE_DEBUG.KING_SECURITY_BISHOP[side],
-            -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & bishop));
-    }
+    structureEval.kingSecurity[side] -=
+            ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & bishop);
+    ADD(SCORE_DEBUG.KING_SECURITY_BISHOP[side],
+        -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & bishop));
 
     // 4. undevelop
-    if (phase != END) {
-        result -= UNDEVELOPED_BISHOP * bitCount(BISHOP_HOME[side] & bishop);
-        ADD(SCORE_DEBUG.UNDEVELOPED_BISHOP[side], UNDEVELOPED_BISHOP * bitCount(BISHOP_HOME[side] & bishop));
-    }
+    result -= S(UNDEVELOPED_BISHOP * bitCount(BISHOP_HOME[side] & bishop), 0);
+    ADD(SCORE_DEBUG.UNDEVELOPED_BISHOP[side], taper(S(UNDEVELOPED_BISHOP * bitCount(BISHOP_HOME[side] & bishop), 0)));
 
     for (; bishop; RESET_LSB(bishop)) {
         const int o = BITScanForward(bishop);
         // 5. mobility
 
-        u64 captured = getDiagCapture(o, structureEval.allPieces, enemies);
-        ASSERT(bitCount(captured) + board::getDiagShiftCount(o, structureEval.allPieces) <
-               (int) (sizeof(MOB_BISHOP) / sizeof(int)))
+        const u64 attacks = getDiagonalAntiDiagonal(o, structureEval.allPieces);
+        structureEval.diagAttacks[o] = attacks;
+        structureEval.attacksByPiece[BISHOP_BLACK + side] |= attacks;
+        const u64 captured = attacks & enemies;
+        const int mob = bitCount(captured) + bitCount(attacks & ~structureEval.allPieces);
+        ASSERT(mob < (int) (sizeof(MOB_BISHOP) / sizeof(int)))
 
         if (captured & structureEval.posKingBit[xside]) {
             structureEval.kingAttackers[xside] |= POW2[o];
         }
 
-        result += MOB_BISHOP[phase][bitCount(captured) + board::getDiagShiftCount(o, structureEval.allPieces)];
-        ADD(SCORE_DEBUG.MOB_BISHOP[side],
-            MOB_BISHOP[phase][bitCount(captured) + board::getDiagShiftCount(o, structureEval.allPieces)]);
+        result += MOB_BISHOP[mob];
+        ADD(SCORE_DEBUG.MOB_BISHOP[side], taper(MOB_BISHOP[mob]));
 
         // 6.
-        if (phase != OPEN) {
-            if ((BIG_DIAGONAL & structureEval.allPieces) == POW2[o]) {
-                ADD(SCORE_DEBUG.OPEN_DIAG_BISHOP[side], OPEN_FILE);
-                result += OPEN_FILE;
-            }
-            if ((BIG_ANTIDIAGONAL & structureEval.allPieces) == POW2[o]) {
-                ADD(SCORE_DEBUG.OPEN_DIAG_BISHOP[side], OPEN_FILE);
-                result += OPEN_FILE;
-            }
+        if ((BIG_DIAGONAL & structureEval.allPieces) == POW2[o]) {
+            ADD(SCORE_DEBUG.OPEN_DIAG_BISHOP[side], OPEN_FILE);
+            result += OPEN_FILE;
         }
-
-        // 7. outposts
-        auto p = BISHOP_OUTPOST[side][o];
-
-        //enemy pawn doesn't attack bishop
-        if (p && !(PAWN_FORK_MASK[xside][o] & chessboard[xside])) {
-            //friend paws defends bishop
-            if (PAWN_FORK_MASK[side ^ 1][o] & chessboard[side]) {
-                result += p;
-                if (!(chessboard[KNIGHT_BLACK + xside]) &&
-                    !(chessboard[BISHOP_BLACK + xside] & board::colors(o))) {
-                    result += p;
-                }
-            }
+        if ((BIG_ANTIDIAGONAL & structureEval.allPieces) == POW2[o]) {
+            ADD(SCORE_DEBUG.OPEN_DIAG_BISHOP[side], OPEN_FILE);
+            result += OPEN_FILE;
         }
     }
+
+    // 7. outposts
+    result += evaluateOutposts<side>(BISHOP_OUTPOST[side], chessboard[BISHOP_BLACK + side]);
     return result;
 }
 
 /**
- * evaluate queen for color at phase
- * 2. *king security* - in OPEN phase add at kingSecurity FRIEND_NEAR_KING for each queen near to king and substracts ENEMY_NEAR_KING for each queen near to enemy king
- * 3. mobility - MOB_QUEEN[phase][position]
+ * evaluate queen for color, the result is a mid/end game pair
+ * 2. *king security* - add at kingSecurity FRIEND_NEAR_KING for each queen near to king and substracts ENEMY_NEAR_KING for each queen near to enemy king
+ * 3. mobility - MOB_QUEEN[position]
  * 4. half open file - if there is a enemy pawn on same file add HALF_OPEN_FILE_Q
  * 5. open file - if there is any pieces on same file add OPEN_FILE_Q
  * 6. 5. bishop on queen - if there is a bishop on same diagonal add BISHOP_ON_QUEEN
  */
-template<int side, Eval::_Tphase phase>
+template<int side>
 int Eval::evaluateQueen(const u64 enemies) {
     INC(evaluationCount[side]);
     u64 queen = chessboard[QUEEN_BLACK + side];
     int result = 0;
     constexpr int xside = side ^1;
     // 2. *king security*
-    if (phase != OPEN) {
-        structureEval.kingSecurity[side] +=
-                FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & queen);
-        ADD(SCORE_DEBUG.KING_SECURITY_QUEEN[side],
-            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & queen));
+    structureEval.kingSecurity[side] +=
+            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & queen);
+    ADD(SCORE_DEBUG.KING_SECURITY_QUEEN[side],
+        FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & queen));
 
-        structureEval.kingSecurity[side] -=
-                ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & queen);
-        ADD(SCORE_DEBUG.KING_SECURITY_QUEEN[xside],
-            -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & queen));
-    }
+    structureEval.kingSecurity[side] -=
+            ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & queen);
+    ADD(SCORE_DEBUG.KING_SECURITY_QUEEN[xside],
+        -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & queen));
 
     for (; queen; RESET_LSB(queen)) {
         const int o = BITScanForward(queen);
         // 3. mobility
-        u64 x = board::getMobilityQueen(o, enemies, structureEval.allPieces);
-        result += MOB_QUEEN[phase][bitCount(x)];
-        ADD(SCORE_DEBUG.MOB_QUEEN[side], MOB_QUEEN[phase][bitCount(x)]);
+        const u64 diag = getDiagonalAntiDiagonal(o, structureEval.allPieces);
+        const u64 rankFile = getRankFile(o, structureEval.allPieces);
+        structureEval.diagAttacks[o] = diag;
+        structureEval.rankFileAttacks[o] = rankFile;
+        structureEval.attacksByPiece[QUEEN_BLACK + side] |= diag | rankFile;
+        const u64 x = (diag | rankFile) & (enemies | ~structureEval.allPieces);
+        result += MOB_QUEEN[bitCount(x)];
+        ADD(SCORE_DEBUG.MOB_QUEEN[side], taper(MOB_QUEEN[bitCount(x)]));
 
         if (x & structureEval.posKingBit[xside])
             structureEval.kingAttackers[xside] |= POW2[o];
         // 4. half open file
-        if ((chessboard[xside] & FILE_[o])) {
+        if (!(pawnEntry->openFiles[xside] & POW2[o])) {
             ADD(SCORE_DEBUG.HALF_OPEN_FILE_Q[side], HALF_OPEN_FILE_Q);
             result += HALF_OPEN_FILE_Q;
         }
@@ -290,15 +593,15 @@ int Eval::evaluateQueen(const u64 enemies) {
 }
 
 /**
- * evaluate knight for color at phase
+ * evaluate knight for color, the result is a mid/end game pair
  * 1. // pinned
- * 2. undevelop - substracts UNDEVELOPED_KNIGHT for each undeveloped knight
- * 4. *king security* - in OPEN phase add at kingSecurity FRIEND_NEAR_KING for each knight near to king and substracts ENEMY_NEAR_KING for each knight near to enemy king
+ * 2. undevelop - in middle game substracts UNDEVELOPED_KNIGHT for each undeveloped knight
+ * 4. *king security* - add at kingSecurity FRIEND_NEAR_KING for each knight near to king and substracts ENEMY_NEAR_KING for each knight near to enemy king
  * 5. mobility
  * 6. outposts
 */
 
-template<int side, Eval::_Tphase phase>
+template<int side>
 int Eval::evaluateKnight(const u64 notMyBits) {
     INC(evaluationCount[side]);
     u64 knight = chessboard[KNIGHT_BLACK + side];
@@ -308,64 +611,49 @@ int Eval::evaluateKnight(const u64 notMyBits) {
     int result = 0;
 
     // 2. undevelop
-    if (phase == OPEN) {
-        result -= bitCount(knight & KNIGHT_HOME[side]) * UNDEVELOPED_KNIGHT;
-        ADD(SCORE_DEBUG.UNDEVELOPED_KNIGHT[side],
-            bitCount(knight & KNIGHT_HOME[side]) * UNDEVELOPED_KNIGHT);
-    }
+    result -= S(bitCount(knight & KNIGHT_HOME[side]) * UNDEVELOPED_KNIGHT, 0);
+    ADD(SCORE_DEBUG.UNDEVELOPED_KNIGHT[side],
+        taper(S(bitCount(knight & KNIGHT_HOME[side]) * UNDEVELOPED_KNIGHT, 0)));
 
     // 4. king security
-    if (phase != OPEN) {
-        structureEval.kingSecurity[side] +=
-                FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & knight);
-        ADD(SCORE_DEBUG.KING_SECURITY_KNIGHT[side],
-            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & knight));
-
-        structureEval.kingSecurity[side] -=
-                ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & knight);
-        ADD(SCORE_DEBUG.KING_SECURITY_KNIGHT[xside],
-            -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & knight));
-    }
+    structureEval.kingSecurity[side] +=
+            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & knight);
+    ADD(SCORE_DEBUG.KING_SECURITY_KNIGHT[side],
+        FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & knight));
+
+    structureEval.kingSecurity[side] -=
+            ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & knight);
+    ADD(SCORE_DEBUG.KING_SECURITY_KNIGHT[xside],
+        -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & knight));
     for (; knight; RESET_LSB(knight)) {
         const int pos = BITScanForward(knight);
 
         // 5. mobility
         ASSERT(bitCount(notMyBits & KNIGHT_MASK[pos]) < (int) (sizeof(MOB_KNIGHT) / sizeof(int)))
+        structureEval.attacksByPiece[KNIGHT_BLACK + side] |= KNIGHT_MASK[pos];
         u64 mob = notMyBits & KNIGHT_MASK[pos];
         result += MOB_KNIGHT[bitCount(mob)];
         if (mob & structureEval.posKingBit[xside]) structureEval.kingAttackers[xside] |= POW2[pos];
         ADD(SCORE_DEBUG.MOB_KNIGHT[side], MOB_KNIGHT[bitCount(mob)]);
-
-        // 6. outposts
-        auto p = KNIGHT_OUTPOST[side][pos];
-
-        //enemy pawn doesn't attack knight
-        if (p && !(PAWN_FORK_MASK[xside][pos] & chessboard[xside])) {
-            //friend paws defends knight
-            if (PAWN_FORK_MASK[xside][pos] & chessboard[side]) {
-                result += p;
-                if (!(chessboard[KNIGHT_BLACK + xside]) &&
-                    !(chessboard[BISHOP_BLACK + xside] & board::colors(pos))) {
-                    result += p;
-                }
-            }
-        }
     }
+
+    // 6. outposts
+    result += evaluateOutposts<side>(KNIGHT_OUTPOST[side], chessboard[KNIGHT_BLACK + side]);
     return result;
 }
 
 
 /**
- * evaluate rook for color at phase
+ * evaluate rook for color, the result is a mid/end game pair
  * 1. if no rooks returns 0
- * 3. in middle if in 7th - add ROOK_7TH_RANK for each rook in 7th
- * 4. *king security* - in OPEN phase add at kingSecurity FRIEND_NEAR_KING for each rook near to king and substracts ENEMY_NEAR_KING for each rook near to enemy king
+ * 3. in middle game if in 7th - add ROOK_7TH_RANK for each rook in 7th
+ * 4. *king security* - add at kingSecurity FRIEND_NEAR_KING for each rook near to king and substracts ENEMY_NEAR_KING for each rook near to enemy king
  * 5. add OPEN_FILE/HALF_OPEN_FILE if the rook is on open/semiopen file
  * 6. trapped
  * 7. 2 linked towers
  * 8. Penalise if Rook is Blocked Horizontally
 */
-template<int side, Eval::_Tphase phase>
+template<int side>
 int Eval::evaluateRook(const u64 king, const u64 enemies, const u64 friends) {
     INC(evaluationCount[side]);
 
@@ -377,24 +665,19 @@ int Eval::evaluateRook(const u64 king, const u64 enemies, const u64 friends) {
     int result = 0;
     constexpr int xside = side ^1;
     // 3. in 7th
-    if (phase == MIDDLE) {
-        result += ROOK_7TH_RANK * bitCount(rook & RANK_1_7[side]);
-        ADD(SCORE_DEBUG.ROOK_7TH_RANK[side], ROOK_7TH_RANK * bitCount(rook & RANK_1_7[side]));
-    }
+    result += S(ROOK_7TH_RANK * bitCount(rook & RANK_1_7[side]), 0);
+    ADD(SCORE_DEBUG.ROOK_7TH_RANK[side], taper(S(ROOK_7TH_RANK * bitCount(rook & RANK_1_7[side]), 0)));
 
     // 4. king security
-    if (phase != OPEN) {
-        structureEval.kingSecurity[side] +=
-                FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & rook);
-        ADD(SCORE_DEBUG.KING_SECURITY_ROOK[side],
-            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & rook));
+    structureEval.kingSecurity[side] +=
+            FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & rook);
+    ADD(SCORE_DEBUG.KING_SECURITY_ROOK[side],
+        FRIEND_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[side]] & rook));
 
-        structureEval.kingSecurity[side] -=
-                ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & rook);
-        ADD(SCORE_DEBUG.KING_SECURITY_ROOK[xside],
-            -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & rook));
-
-    }
+    structureEval.kingSecurity[side] -=
+            ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & rook);
+    ADD(SCORE_DEBUG.KING_SECURITY_ROOK[xside],
+        -ENEMY_NEAR_KING * bitCount(NEAR_MASK2[structureEval.posKing[xside]] & rook));
 
     // .6
     if (((F1G1bit[side] & king) && (H1H2G1bit[side] & rook)) || ((C1B1bit[side] & king) && (A1A2B1bit[side] & rook))) {
@@ -415,27 +698,28 @@ int Eval::evaluateRook(const u64 king, const u64 enemies, const u64 friends) {
     for (; rook; RESET_LSB(rook)) {
         const int o = BITScanForward(rook);
         //mobility
-        u64 mob = board::getMobilityRook(o, enemies, friends);
+        const u64 attacks = getRankFile(o, structureEval.allPieces);
+        structureEval.rankFileAttacks[o] = attacks;
+        structureEval.attacksByPiece[ROOK_BLACK + side] |= attacks;
+        u64 mob = attacks & ~friends;
         if (mob & structureEval.posKingBit[xside]) structureEval.kingAttackers[xside] |= POW2[o];
 
-        ASSERT(bitCount(mob) < (int) (sizeof(MOB_ROOK[phase]) / sizeof(int)))
-        result += MOB_ROOK[phase][bitCount(mob)];
-        ADD(SCORE_DEBUG.MOB_ROOK[side], MOB_ROOK[phase][bitCount(mob)]);
+        ASSERT(bitCount(mob) < (int) (sizeof(MOB_ROOK) / sizeof(int)))
+        result += MOB_ROOK[bitCount(mob)];
+        ADD(SCORE_DEBUG.MOB_ROOK[side], taper(MOB_ROOK[bitCount(mob)]));
 
-        if (phase != OPEN) {
-            // .8 Penalise if Rook is Blocked Horizontally
-            if ((RANK_BOUND[o] & structureEval.allPieces) == RANK_BOUND[o]) {
-                ADD(SCORE_DEBUG.ROOK_BLOCKED[side], -ROOK_BLOCKED);
-                result -= ROOK_BLOCKED;
-            }
+        // .8 Penalise if Rook is Blocked Horizontally
+        if ((RANK_BOUND[o] & structureEval.allPieces) == RANK_BOUND[o]) {
+            ADD(SCORE_DEBUG.ROOK_BLOCKED[side], -ROOK_BLOCKED);
+            result -= ROOK_BLOCKED;
         }
 
         // .5
-        if (!(chessboard[side] & FILE_[o])) {
+        if (pawnEntry->openFiles[side] & POW2[o]) {
             ADD(SCORE_DEBUG.ROOK_OPEN_FILE[side], OPEN_FILE);
             result += OPEN_FILE;
         }
-        if (!(chessboard[xside] & FILE_[o])) {
+        if (pawnEntry->openFiles[xside] & POW2[o]) {
             ADD(SCORE_DEBUG.ROOK_OPEN_FILE[side], OPEN_FILE);
             result += OPEN_FILE;
         }
@@ -443,23 +727,17 @@ int Eval::evaluateRook(const u64 king, const u64 enemies, const u64 friends) {
     return result;
 }
 
-template<Eval::_Tphase phase>
+// the result is a mid/end game pair
 int Eval::evaluateKing(int side, u64 squares) {
     ASSERT(evaluationCount[side] == 5)
-    int result = 0;
     uchar pos_king = structureEval.posKing[side];
-    if (phase == END) {
-        ADD(SCORE_DEBUG.DISTANCE_KING[side], DISTANCE_KING_ENDING[pos_king]);
-        result = DISTANCE_KING_ENDING[pos_king];
-    } else {
-        ADD(SCORE_DEBUG.DISTANCE_KING[side], DISTANCE_KING_OPENING[pos_king]);
-        result = DISTANCE_KING_OPENING[pos_king];
-    }
-    
+    int result = S(DISTANCE_KING_OPENING[pos_king], DISTANCE_KING_ENDING[pos_king]);
+    ADD(SCORE_DEBUG.DISTANCE_KING[side], taper(result));
+
     //mobility
-    ASSERT(bitCount(squares & NEAR_MASK1[pos_king]) < (int) (sizeof(MOB_KING[phase]) / sizeof(int)))
-    result += MOB_KING[phase][bitCount(squares & NEAR_MASK1[pos_king])];
-    ADD(SCORE_DEBUG.MOB_KING[side], MOB_KING[phase][bitCount(squares & NEAR_MASK1[pos_king])]);
+    ASSERT(bitCount(squares & NEAR_MASK1[pos_king]) < (int) (sizeof(MOB_KING) / sizeof(int)))
+    result += MOB_KING[bitCount(squares & NEAR_MASK1[pos_king])];
+    ADD(SCORE_DEBUG.MOB_KING[side], taper(MOB_KING[bitCount(squares & NEAR_MASK1[pos_king])]));
 
     ASSERT(pos_king < 64)
     if (!(NEAR_MASK1[pos_king] & chessboard[side])) {
@@ -470,13 +748,20 @@ int Eval::evaluateKing(int side, u64 squares) {
     return result;
 }
 
+/**
+ * interpolation of a mid/end game pair by the phase of the position
+ */
+int Eval::taper(const int score) const {
+    return (mgScore(score) * phase + egScore(score) * (PHASE_MAX - phase)) / PHASE_MAX;
+}
+
 void Eval::storeHashValue(const u64 key, const short value) {
-    evalHash[key % hashSize] = (key & keyMask) | (value & valueMask);
+    evalHash[key & evalHashMask] = (key & keyMask) | (value & valueMask);
     ASSERT(value == getHashValue(key))
 }
 
-short Eval::getHashValue(const u64 key) {
-    const u64 kv = evalHash[key % hashSize];
+short Eval::getHashValue(const u64 key) const {
+    const u64 kv = evalHash[key & evalHashMask];
     if ((kv & keyMask) == (key & keyMask))
         return (short) (kv & valueMask);
 
@@ -485,11 +770,23 @@ short Eval::getHashValue(const u64 key) {
 
 short Eval::getScore(const u64 key, const int side, const int alpha, const int beta, const bool trace) {
     const short hashValue = getHashValue(key);
+    STATS(nEvalHashProbe++)
     if (hashValue != noHashValue) {
+        STATS(nEvalHashHit++)
         return side ? -hashValue : hashValue;
     }
-    int lazyscore_white = lazyEvalSide<WHITE>();
-    int lazyscore_black = lazyEvalSide<BLACK>();
+    const _Tmaterial &materialEntry = getMaterial();
+    if (materialEntry.endgame != ENDGAME_NONE) {
+        const int score = (this->*ENDGAMES[materialEntry.endgame][materialEntry.strongSide])();
+        const short result = (short) (materialEntry.strongSide == BLACK ? score : -score);
+        if (trace) {
+            cout << "\n|Total endgame (white)..........   " << (side ? result / 100.0 : -result / 100.0) << endl;
+        }
+        storeHashValue(key, result);
+        return side ? -result : result;
+    }
+    int lazyscore_white = material[WHITE];
+    int lazyscore_black = material[BLACK];
     int lazyscore = lazyscore_black - lazyscore_white;
     if (side) {
         lazyscore = -lazyscore;
@@ -498,21 +795,22 @@ short Eval::getScore(const u64 key, const int side, const int alpha, const int b
         INC(lazyEvalCuts);
         return lazyscore;
     }
+    if (nnue) {
+        const int score = nnue->evaluate(chessboard, side);
+        const short result = (short) (side ? -score : score);
+        if (trace) {
+            cout << "\n|Total NNUE (white)..........   " << (side ? result / 100.0 : -result / 100.0) << endl;
+        }
+        storeHashValue(key, result);
+        return (short) score;
+    }
 
 #ifdef DEBUG_MODE
     evaluationCount[WHITE] = evaluationCount[BLACK] = 0;
     memset(&SCORE_DEBUG, 0, sizeof(_TSCORE_DEBUG));
 #endif
     memset(structureEval.kingSecurity, 0, sizeof(structureEval.kingSecurity));
-    int npieces = board::getNpiecesNoPawnNoKing<WHITE>(chessboard) + board::getNpiecesNoPawnNoKing<BLACK>(chessboard);
-    _Tphase phase;
-    if (npieces < 6) {
-        phase = END;
-    } else if (npieces < 11) {
-        phase = MIDDLE;
-    } else {
-        phase = OPEN;
-    }
+    phase = materialEntry.phase;
     structureEval.allPiecesNoPawns[BLACK] = board::getBitmapNoPawns<BLACK>(chessboard);
     structureEval.allPiecesNoPawns[WHITE] = board::getBitmapNoPawns<WHITE>(chessboard);
     structureEval.allPiecesSide[BLACK] = structureEval.allPiecesNoPawns[BLACK] | chessboard[PAWN_BLACK];
@@ -523,52 +821,46 @@ short Eval::getScore(const u64 key, const int side, const int alpha, const int b
     structureEval.posKingBit[BLACK] = POW2[structureEval.posKing[BLACK]];
     structureEval.posKingBit[WHITE] = POW2[structureEval.posKing[WHITE]];
     structureEval.kingAttackers[WHITE] = structureEval.kingAttackers[BLACK] = 0;
+    structureEval.attackKey = 0;
+    memset(structureEval.attacksByPiece, 0, sizeof(structureEval.attacksByPiece));
+    pawnEntry = probePawnHash(trace);
 
     _Tresult Tresult;
-    switch (phase) {
-        case OPEN :
-            getRes<OPEN>(Tresult);
-            break;
-        case END :
-            getRes<END>(Tresult);
-            break;
-        case MIDDLE:
-            getRes<MIDDLE>(Tresult);
-            break;
-        default:
-            break;
-    }
-    int bonus_attack_king_black = 0;
-    int bonus_attack_king_white = 0;
-    if (phase != OPEN) {
-        bonus_attack_king_black = BONUS_ATTACK_KING[bitCount(structureEval.kingAttackers[WHITE])];
-        bonus_attack_king_white = BONUS_ATTACK_KING[bitCount(structureEval.kingAttackers[BLACK])];
-    }
-
-    ASSERT(getMobilityCastle<WHITE>(structureEval.allPieces) < (int) (sizeof(MOB_CASTLE[phase]) / sizeof(int)))
-    ASSERT(getMobilityCastle<BLACK>(structureEval.allPieces) < (int) (sizeof(MOB_CASTLE[phase]) / sizeof(int)))
-    int mobWhite = MOB_CASTLE[phase][getMobilityCastle<WHITE>(structureEval.allPieces)];
-    int mobBlack = MOB_CASTLE[phase][getMobilityCastle<BLACK>(structureEval.allPieces)];
+    getRes(Tresult);
+    setAttackMap();
+    const int bonus_attack_king_black = BONUS_ATTACK_KING[bitCount(structureEval.kingAttackers[WHITE])];
+    const int bonus_attack_king_white = BONUS_ATTACK_KING[bitCount(structureEval.kingAttackers[BLACK])];
+
+    ASSERT(getMobilityCastle<WHITE>(structureEval.allPieces) < (int) (sizeof(MOB_CASTLE) / sizeof(int)))
+    ASSERT(getMobilityCastle<BLACK>(structureEval.allPieces) < (int) (sizeof(MOB_CASTLE) / sizeof(int)))
+    int mobWhite = MOB_CASTLE[getMobilityCastle<WHITE>(structureEval.allPieces)];
+    int mobBlack = MOB_CASTLE[getMobilityCastle<BLACK>(structureEval.allPieces)];
     int attack_king_white = ATTACK_KING * bitCount(structureEval.kingAttackers[BLACK]);
     int attack_king_black = ATTACK_KING * bitCount(structureEval.kingAttackers[WHITE]);
     side == WHITE ? lazyscore_black -= 5 : lazyscore_white += 5;
-    int result = (mobBlack + attack_king_black + bonus_attack_king_black + lazyscore_black + Tresult.pawns[BLACK] +
-                  Tresult.knights[BLACK] + Tresult.bishop[BLACK] + Tresult.rooks[BLACK] + Tresult.queens[BLACK] +
-                  Tresult.kings[BLACK]) -
-                 (mobWhite + attack_king_white + bonus_attack_king_white + lazyscore_white + Tresult.pawns[WHITE] +
-                  Tresult.knights[WHITE] + Tresult.bishop[WHITE] + Tresult.rooks[WHITE] + Tresult.queens[WHITE] +
-                  Tresult.kings[WHITE]);
+    // the positional terms are mid/end game pairs interpolated once, the material doesn't depend on the phase
+    int result = taper((mobBlack + attack_king_black + bonus_attack_king_black + Tresult.pawns[BLACK] +
+                        Tresult.knights[BLACK] + Tresult.bishop[BLACK] + Tresult.rooks[BLACK] +
+                        Tresult.queens[BLACK] + Tresult.kings[BLACK]) -
+                       (mobWhite + attack_king_white + bonus_attack_king_white + Tresult.pawns[WHITE] +
+                        Tresult.knights[WHITE] + Tresult.bishop[WHITE] + Tresult.rooks[WHITE] +
+                        Tresult.queens[WHITE] + Tresult.kings[WHITE])) + lazyscore_black - lazyscore_white;
+    // endgame scaling of the side ahead
+    result = result * materialEntry.scale[result > 0 ? BLACK : WHITE] / SCALE_NORMAL;
 
 #ifdef DEBUG_MODE
     if (trace) {
         const string HEADER = "\n|\t\t\t\t\tTOT (white)\t\t  WHITE\t\tBLACK\n";
-        cout << "|PHASE: ";
-        if (phase == OPEN) {
-            cout << " OPEN\n";
-        } else if (phase == MIDDLE) {
-            cout << " MIDDLE\n";
-        } else {
-            cout << " END\n";
+        cout << "|PHASE: " << phase << "/" << PHASE_MAX << "\n";
+        mobWhite = taper(mobWhite);
+        mobBlack = taper(mobBlack);
+        for (int s = BLACK; s <= WHITE; s++) {
+            Tresult.pawns[s] = taper(Tresult.pawns[s]);
+            Tresult.bishop[s] = taper(Tresult.bishop[s]);
+            Tresult.queens[s] = taper(Tresult.queens[s]);
+            Tresult.rooks[s] = taper(Tresult.rooks[s]);
+            Tresult.knights[s] = taper(Tresult.knights[s]);
+            Tresult.kings[s] = taper(Tresult.kings[s]);
         }
 
         cout << "|VALUES:";
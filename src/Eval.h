@@ -26,6 +26,12 @@
 #endif
 #include <fstream>
 #include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+
+#include <immintrin.h>
+
+#endif
 #include <iomanip>
 
 using namespace constants;
@@ -36,18 +42,83 @@ public:
 
     Eval();
 
+    Eval(const Eval &) = delete;
+
     ~Eval() override;
 
+    // per-thread evaluation cache, rounded down to a power of two number of entries
+    void setEvalHashSize(const int mb);
+
+    void clearEvalHash();
+
+#ifdef BENCH_MODE
+
+    // uses the eval cache of owner, one table for all the threads as before the per-thread caches (the baseline
+    // of -bench-eval-cache); setEvalHashSize gives back an own table
+    void shareEvalHash(const Eval &owner);
+
+#endif
+
+    static constexpr int EVAL_HASH_SIZE_DEFAULT = 1;
+
+    // score of the won known endgames, see setMaterial
+    static constexpr int KNOWN_WIN = 1000;
+
+    static constexpr int PHASE_MAX = 24;
+
+    // 0 (end game) .. PHASE_MAX (middle game) from the pieces on the board, see taper
+    int getPhase() {
+        return getMaterial().phase;
+    }
+
     short getScore(const u64 key, const int side, const int alpha, const int beta, const bool trace);
 
     template<int side>
-    int lazyEval() {
-        return lazyEvalSide<side>() - lazyEvalSide<side ^ 1>();
+    int lazyEval() const {
+        return material[side] - material[side ^ 1];
+    }
+
+    inline void prefetchEval(const u64 key) const {
+        __builtin_prefetch(&evalHash[key & evalHashMask]);
     }
 
     DEBUG(unsigned lazyEvalCuts)
 
+    // sum of table[square] for each square in bits, vectorized on all the squares of a piece type at once
+    static int tableSum(const int *table, const u64 bits);
+
+    static int tableSumScalar(const int *table, u64 bits) {
+        int sum = 0;
+        for (; bits; RESET_LSB(bits)) {
+            sum += table[BITScanForward(bits)];
+        }
+        return sum;
+    }
+
 protected:
+    static constexpr int SCALE_NORMAL = 64;
+
+    // everything that depends only on the piece counts, indexed by ChessBoard::materialKey
+    typedef struct {
+        uchar phase; // 0 (end game) .. PHASE_MAX (middle game)
+        uchar insufficient;
+        uchar scale[2];
+        uchar endgame;
+        uchar strongSide;
+    } _Tmaterial;
+
+    // known endgames evaluated without the general pipeline, see ENDGAMES
+    enum _Tendgame : uchar {
+        ENDGAME_NONE, ENDGAME_KXK, ENDGAME_KBNK, ENDGAME_KQKR, ENDGAME_KRKM, ENDGAME_N
+    };
+
+    const _Tmaterial &getMaterial() {
+        if (materialKey < MATERIAL_OVERFLOW) {
+            return materialTable[materialKey];
+        }
+        return getMaterialOverflow();
+    }
+
     STATIC_CONST int FUTIL_MARGIN = 154;
     STATIC_CONST int EXT_FUTILY_MARGIN = 392;
     STATIC_CONST int RAZOR_MARGIN = 1071;
@@ -76,6 +147,9 @@ protected:
     STATIC_CONST int ROOK_TRAPPED = 6;
     STATIC_CONST int UNDEVELOPED_KNIGHT = 4;
     STATIC_CONST int UNDEVELOPED_BISHOP = 4;
+    STATIC_CONST int PUSH_TO_EDGE = 20;
+    STATIC_CONST int PUSH_TO_CORNER = 40;
+    STATIC_CONST int PUSH_CLOSE = 10;
 #ifdef DEBUG_MODE
     typedef struct {
         int BAD_BISHOP[2];
@@ -128,23 +202,84 @@ protected:
 #endif
 
 private:
-    static constexpr int hashSize = 65536;
     static constexpr u64 keyMask = 0xffffffffffff0000ULL;
     static constexpr u64 valueMask = 0xffffULL;
     static constexpr short noHashValue = (short) 0xffff;
 
-    static u64 *evalHash;
+    u64 *evalHash = nullptr;
+    u64 evalHashMask;
+#ifdef BENCH_MODE
+    // evalHash is the table of another thread
+    bool sharedEvalHash = false;
+#endif
+
+    static _Tmaterial materialTable[MATERIAL_OVERFLOW];
+    static volatile bool materialGenerated;
+    static mutex mutexMaterial;
+    _Tmaterial materialOverflow;
+
+    static void initMaterialTable();
+
+    static void setMaterial(const int count[12], _Tmaterial &material);
+
+    const _Tmaterial &getMaterialOverflow();
+
+    typedef int (Eval::*_TendgameFn)() const;
+
+    // [endgame][strong side], scores for the strong side
+    static const _TendgameFn ENDGAMES[ENDGAME_N][2];
+
+    static int centerDistance(const int sq) {
+        const int file = sq & 7;
+        const int rank = sq >> 3;
+        return max(3 - file, file - 4) + max(3 - rank, rank - 4);
+    }
+
+    static int distance(const int sq1, const int sq2) {
+        return max(abs((sq1 & 7) - (sq2 & 7)), abs((sq1 >> 3) - (sq2 >> 3)));
+    }
+
+    template<int strong>
+    int evaluateKXK() const;
+
+    template<int strong>
+    int evaluateKBNK() const;
+
+    template<int strong>
+    int evaluateKQKR() const;
+
+    template<int strong>
+    int evaluateKRKM() const;
+
+    static constexpr int PAWN_HASH_SIZE = 16384;
+
+    // pawn-only terms and bitboards, keyed by ChessBoard::pawnKey
+    typedef struct {
+        u64 key;
+        u64 passed[2];
+        u64 attacks[2];
+        u64 openFiles[2];
+        short structure[2];
+        uchar center[2];
+        uchar in7[2];
+    } _TpawnEntry;
+
+    _TpawnEntry *pawnHash = nullptr;
+    const _TpawnEntry *pawnEntry;
+
+    template<int side>
+    void evaluatePawnStructure(_TpawnEntry &entry);
+
+    const _TpawnEntry *probePawnHash(const bool trace);
+
+    void setAttackMap();
 
     inline void storeHashValue(const u64 key, const short value);
 
-    static inline short getHashValue(const u64 key) ;
+    inline short getHashValue(const u64 key) const;
 #ifdef BENCH_MODE
     Times* times = &Times::getInstance();
 #endif
-    enum _Tphase {
-        OPEN, MIDDLE, END
-    };
-
     typedef struct {
         int pawns[2];
         int bishop[2];
@@ -156,73 +291,88 @@ private:
 
     DEBUG(int evaluationCount[2])
 
-    template<_Tphase phase>
+    // phase of the position in evaluation, see taper
+    int phase;
+
+    int taper(const int score) const;
+
+    // mid/end game pairs, see _eval::S
     void getRes(_Tresult &res) {
 
         BENCH(times->start("eval pawn"));
-        res.pawns[BLACK] = evaluatePawn<BLACK, phase>();
-        res.pawns[WHITE] = evaluatePawn<WHITE, phase>();
+        res.pawns[BLACK] = evaluatePawn<BLACK>();
+        res.pawns[WHITE] = evaluatePawn<WHITE>();
         BENCH(times->stop("eval pawn"));
 
         BENCH(times->start("eval bishop"));
-        res.bishop[BLACK] = evaluateBishop<BLACK, phase>(structureEval.allPiecesSide[WHITE]);
-        res.bishop[WHITE] = evaluateBishop<WHITE, phase>(structureEval.allPiecesSide[BLACK]);
+        res.bishop[BLACK] = evaluateBishop<BLACK>(structureEval.allPiecesSide[WHITE]);
+        res.bishop[WHITE] = evaluateBishop<WHITE>(structureEval.allPiecesSide[BLACK]);
         BENCH(times->stop("eval bishop"));
 
         BENCH(times->start("eval queen"));
-        res.queens[BLACK] = evaluateQueen<BLACK, phase>(structureEval.allPiecesSide[WHITE]);
-        res.queens[WHITE] = evaluateQueen<WHITE, phase>(structureEval.allPiecesSide[BLACK]);
+        res.queens[BLACK] = evaluateQueen<BLACK>(structureEval.allPiecesSide[WHITE]);
+        res.queens[WHITE] = evaluateQueen<WHITE>(structureEval.allPiecesSide[BLACK]);
         BENCH(times->stop("eval queen"));
 
         BENCH(times->start("eval rook"));
-        res.rooks[BLACK] = evaluateRook<BLACK, phase>(chessboard[KING_BLACK], structureEval.allPiecesSide[WHITE],
+        res.rooks[BLACK] = evaluateRook<BLACK>(chessboard[KING_BLACK], structureEval.allPiecesSide[WHITE],
                                                       structureEval.allPiecesSide[BLACK]);
-        res.rooks[WHITE] = evaluateRook<WHITE, phase>(chessboard[KING_WHITE], structureEval.allPiecesSide[BLACK],
+        res.rooks[WHITE] = evaluateRook<WHITE>(chessboard[KING_WHITE], structureEval.allPiecesSide[BLACK],
                                                       structureEval.allPiecesSide[WHITE]);
         BENCH(times->stop("eval rook"));
 
         BENCH(times->start("eval knight"));
-        res.knights[BLACK] = evaluateKnight<BLACK, phase>(~structureEval.allPiecesSide[BLACK]);
-        res.knights[WHITE] = evaluateKnight<WHITE, phase>(~structureEval.allPiecesSide[WHITE]);
+        res.knights[BLACK] = evaluateKnight<BLACK>(~structureEval.allPiecesSide[BLACK]);
+        res.knights[WHITE] = evaluateKnight<WHITE>(~structureEval.allPiecesSide[WHITE]);
         BENCH(times->stop("eval knight"));
 
         BENCH(times->start("eval king"));
-        res.kings[BLACK] = evaluateKing<phase>(BLACK, ~structureEval.allPiecesSide[BLACK]);
-        res.kings[WHITE] = evaluateKing<phase>(WHITE, ~structureEval.allPiecesSide[WHITE]);
+        res.kings[BLACK] = evaluateKing(BLACK, ~structureEval.allPiecesSide[BLACK]);
+        res.kings[WHITE] = evaluateKing(WHITE, ~structureEval.allPiecesSide[WHITE]);
         BENCH(times->stop("eval king"));
     }
 
-    template<int side, _Tphase phase>
+    template<int side>
     int evaluatePawn();
 
-    template<int side, _Tphase phase>
+    template<int side>
     int evaluateBishop(const u64);
 
-    template<int side, Eval::_Tphase phase>
+    template<int side>
     int evaluateQueen(const u64 enemies);
 
-    template<int side, _Tphase phase>
+    template<int side>
     int evaluateKnight(const u64);
 
-    template<int side, Eval::_Tphase phase>
+    template<int side>
     int evaluateRook(const u64, u64 enemies, u64 friends);
 
-    template<_Tphase phase>
     int evaluateKing(int side, u64 squares);
 
     template<int side>
-    int lazyEvalSide() {
-        return bitCount(chessboard[PAWN_BLACK + side]) * VALUEPAWN +
-            bitCount(chessboard[ROOK_BLACK + side]) * VALUEROOK +
-            bitCount(chessboard[BISHOP_BLACK + side]) * VALUEBISHOP +
-            bitCount(chessboard[KNIGHT_BLACK + side]) * VALUEKNIGHT +
-            bitCount(chessboard[QUEEN_BLACK + side]) * VALUEQUEEN;
-    }
+    int evaluateOutposts(const int *table, const u64 pieces) const;
 
 };
 
 namespace _eval {
 
+    /*
+     * middle game and end game score pair packed in an int: the middle game value in the low 16 bits and the
+     * end game minus middle game difference in the high ones, so a term that doesn't depend on the phase is a
+     * plain int. Pairs are summed as ints and interpolated once in Eval::taper
+     */
+    constexpr int S(const int mg, const int eg) {
+        return (int) ((unsigned) (eg - mg) << 16) + mg;
+    }
+
+    inline int mgScore(const int score) {
+        return (short) (unsigned) score;
+    }
+
+    inline int egScore(const int score) {
+        return mgScore(score) + (short) ((unsigned) (score + 0x8000) >> 16);
+    }
+
     constexpr int BISHOP_OUTPOST[2][64] = {
         {0, 0, 0, 0, 0, 0, 0, 0,
          0, 0, 0, 0, 0, 0, 0, 0,
@@ -261,16 +411,15 @@ namespace _eval {
          0, 0, 0, 0, 0, 0, 0, 0,
          0, 0, 0, 0, 0, 0, 0, 0}
     };
-    static constexpr int
-        MOB_QUEEN[3][29] = {{0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
-                            {-10, -9, -5, 0, 3, 6, 7, 10, 11, 12, 15, 18, 28, 30, 32, 35, 40, 50, 51, 52, 53, 54, 55,
-                             56, 57, 58, 59, 60, 61},
-                            {-20, -15, -10, 0, 1, 3, 4, 9, 11, 12, 15, 18, 28, 30, 32, 33, 34, 36, 37, 39, 40, 41, 42,
-                             43, 44, 45, 56, 47, 48}};
+    static constexpr int MOB_QUEEN[29] = {S(-10, -20), S(-9, -15), S(-5, -10), S(0, 0), S(3, 1), S(6, 3), S(7, 4),
+                                          S(10, 9), S(11, 11), S(12, 12), S(15, 15), S(18, 18), S(28, 28), S(30, 30),
+                                          S(32, 32), S(35, 33), S(40, 34), S(50, 36), S(51, 37), S(52, 39), S(53, 40),
+                                          S(54, 41), S(55, 42), S(56, 43), S(57, 44), S(58, 45), S(59, 56), S(60, 47),
+                                          S(61, 48)};
 
-    static constexpr int MOB_ROOK[3][15] = {{-1, 0, 1, 4, 5, 6, 7, 9, 12, 14, 19, 22, 23, 24, 25},
-                                            {-9, -8, 1, 8, 9, 10, 15, 20, 28, 30, 40, 45, 50, 51, 52},
-                                            {-15, -10, -5, 0, 9, 11, 16, 22, 30, 32, 40, 45, 50, 51, 52}};
+    static constexpr int MOB_ROOK[15] = {S(-9, -15), S(-8, -10), S(1, -5), S(8, 0), S(9, 9), S(10, 11), S(15, 16),
+                                         S(20, 22), S(28, 30), S(30, 32), S(40, 40), S(45, 45), S(50, 50), S(51, 51),
+                                         S(52, 52)};
 
     static constexpr int MOB_KNIGHT[9] = {-8,
                                           -4,
@@ -282,17 +431,14 @@ namespace _eval {
                                           35,
                                           40};
 
-    static constexpr int MOB_BISHOP[3][14] = {{-8, -7, 2, 8, 9, 10, 15, 20, 28, 30, 40, 45, 50, 50},
-                                              {-20, -10, -4, 0, 5, 10, 15, 20, 28, 30, 40, 45, 50, 50},
-                                              {-20, -10, -4, 0, 3, 8, 13, 18, 25, 30, 40, 45, 50, 50}};
+    static constexpr int MOB_BISHOP[14] = {S(-20, -20), S(-10, -10), S(-4, -4), S(0, 0), S(5, 3), S(10, 8), S(15, 13),
+                                           S(20, 18), S(28, 25), S(30, 30), S(40, 40), S(45, 45), S(50, 50),
+                                           S(50, 50)};
 
-    static constexpr int MOB_KING[3][9] = {{1, 2, 2, 1, 0, 0, 0, 0, 0},
-                                           {-5, 0, 5, 5, 5, 0, 0, 0, 0},
-                                           {-50, -30, -10, 10, 25, 40, 50, 55, 60}};
+    static constexpr int MOB_KING[9] = {S(-5, -50), S(0, -30), S(5, -10), S(5, 10), S(5, 25), S(0, 40), S(0, 50),
+                                        S(0, 55), S(0, 60)};
 
-    static constexpr int MOB_CASTLE[3][3] = {{-50, 30, 50},
-                                             {-1, 10, 10},
-                                             {0, 0, 0}};
+    static constexpr int MOB_CASTLE[3] = {S(-50, 0), S(30, 0), S(50, 0)};
 
     static constexpr int BONUS_ATTACK_KING[18] = {-1, 2, 8, 64, 128, 512, 512, 512, 512, 512, 512, 512, 512, 512, 512,
                                                   512, 512, 512};
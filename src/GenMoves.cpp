@@ -22,6 +22,7 @@ bool GenMoves::forceCheck = false;
 
 GenMoves::GenMoves() : perftMode(false), listId(-1) {
     currentPly = 0;
+    legal.key = 0;
     gen_list = (_TmoveP *) calloc(MAX_PLY, sizeof(_TmoveP));
     _assert(gen_list)
     for (int i = 0; i < MAX_PLY; i++) {
@@ -48,18 +49,28 @@ void GenMoves::setPerft(const bool b) {
     perftMode = b;
 }
 
+void GenMoves::setUseNNUE(const bool b) {
+    if (b && !nnue) {
+        nnue = new NNUE();
+    } else if (!b && nnue) {
+        delete nnue;
+        nnue = nullptr;
+    }
+}
+
 void GenMoves::clearHeuristic() {
     memset(historyHeuristic, 0, sizeof(historyHeuristic));
     memset(killer, 0, sizeof(killer));
 }
 
-_Tmove *GenMoves::getNextMove(_TmoveP *list, const int depth, const Hash::_ThashData *hash, const int first) {
+_Tmove *GenMoves::getNextMove(_TmoveP *list, const int depth, const Hash::_ThashData *hash, const int first,
+                              const int last) {
     BENCH(times->start("getNextMove"))
 
     int bestId = -1;
     int bestScore = -1;
 
-    for (int i = first; i < list->size; i++) {
+    for (int i = first; i < last; i++) {
         auto mos = list->moveList[i];
         int score = 0;
         if (mos.s.type & 0x3) {
@@ -110,6 +121,7 @@ GenMoves::~GenMoves() {
     }
     free(gen_list);
     free(repetitionMap);
+    delete nnue;
 }
 
 void GenMoves::performCastle(const int side, const uchar type) {
@@ -190,33 +202,25 @@ void GenMoves::performCastle(const int side, const uchar type) {
 bool GenMoves::allowCastleBlackQueen(const u64 allpieces) const {
     return POW2_59 & chessboard[KING_BLACK] && chessboard[RIGHT_CASTLE_IDX] & RIGHT_QUEEN_CASTLE_BLACK_MASK &&
            !(allpieces & 0x7000000000000000ULL) && chessboard[ROOK_BLACK] & POW2_63 &&
-           !board::isAttacked<BLACK>(59, allpieces, chessboard) &&
-           !board::isAttacked<BLACK>(60, allpieces, chessboard) &&
-           !board::isAttacked<BLACK>(61, allpieces, chessboard);
+           !anyAttack<BLACK>(0x3800000000000000ULL, allpieces);
 }
 
 bool GenMoves::allowCastleWhiteQueen(const u64 allpieces) const {
     return POW2_3 & chessboard[KING_WHITE] && !(allpieces & 0x70ULL) &&
            chessboard[RIGHT_CASTLE_IDX] & RIGHT_QUEEN_CASTLE_WHITE_MASK && chessboard[ROOK_WHITE] & POW2_7 &&
-           !board::isAttacked<WHITE>(3, allpieces, chessboard) &&
-           !board::isAttacked<WHITE>(4, allpieces, chessboard) &&
-           !board::isAttacked<WHITE>(5, allpieces, chessboard);
+           !anyAttack<WHITE>(0x38ULL, allpieces);
 }
 
 bool GenMoves::allowCastleBlackKing(const u64 allpieces) const {
     return POW2_59 & chessboard[KING_BLACK] && chessboard[RIGHT_CASTLE_IDX] & RIGHT_KING_CASTLE_BLACK_MASK &&
            !(allpieces & 0x600000000000000ULL) && chessboard[ROOK_BLACK] & POW2_56 &&
-           !board::isAttacked<BLACK>(57, allpieces, chessboard) &&
-           !board::isAttacked<BLACK>(58, allpieces, chessboard) &&
-           !board::isAttacked<BLACK>(59, allpieces, chessboard);
+           !anyAttack<BLACK>(0xe00000000000000ULL, allpieces);
 }
 
 bool GenMoves::allowCastleWhiteKing(const u64 allpieces) const {
     return POW2_3 & chessboard[KING_WHITE] && !(allpieces & 0x6ULL) &&
            chessboard[RIGHT_CASTLE_IDX] & RIGHT_KING_CASTLE_WHITE_MASK && chessboard[ROOK_WHITE] & POW2_0 &&
-           !board::isAttacked<WHITE>(1, allpieces, chessboard) &&
-           !board::isAttacked<WHITE>(2, allpieces, chessboard) &&
-           !board::isAttacked<WHITE>(3, allpieces, chessboard);
+           !anyAttack<WHITE>(0xeULL, allpieces);
 }
 
 void GenMoves::unPerformCastle(const int side, const uchar type) {
@@ -279,17 +283,25 @@ void GenMoves::takeback(_Tmove *move, const u64 oldkey, bool rep) {
         ASSERT_RANGE(posTo, 0, 63)
         pieceFrom = move->s.pieceFrom;
         chessboard[pieceFrom] = (chessboard[pieceFrom] & NOTPOW2[posTo]) | POW2[posFrom];
+        if (pieceFrom <= PAWN_WHITE) {
+            updatePawnKey(pieceFrom, posFrom);
+            updatePawnKey(pieceFrom, posTo);
+        }
         if (movecapture != SQUARE_EMPTY) {
             if (((move->s.type & 0x3) != ENPASSANT_MOVE_MASK)) {
                 chessboard[movecapture] |= POW2[posTo];
+                if (movecapture <= PAWN_WHITE) updatePawnKey(movecapture, posTo);
             } else {
                 ASSERT(movecapture == (move->s.side ^ 1))
                 if (move->s.side) {
                     chessboard[movecapture] |= POW2[posTo - 8];
+                    updatePawnKey(movecapture, posTo - 8);
                 } else {
                     chessboard[movecapture] |= POW2[posTo + 8];
+                    updatePawnKey(movecapture, posTo + 8);
                 }
             }
+            addMaterial(movecapture);
         }
     } else if ((move->s.type & 0x3) == PROMOTION_MOVE_MASK) {
         posTo = move->s.to;
@@ -297,13 +309,20 @@ void GenMoves::takeback(_Tmove *move, const u64 oldkey, bool rep) {
         movecapture = move->s.capturedPiece;
         ASSERT(posTo >= 0 && move->s.side >= 0 && move->s.promotionPiece >= 0)
         chessboard[(uchar) move->s.side] |= POW2[posFrom];
+        updatePawnKey(move->s.side, posFrom);
+        addMaterial(move->s.side);
         chessboard[(uchar) move->s.promotionPiece] &= NOTPOW2[posTo];
+        removeMaterial(move->s.promotionPiece);
         if (movecapture != SQUARE_EMPTY) {
             chessboard[movecapture] |= POW2[posTo];
+            if (movecapture <= PAWN_WHITE) updatePawnKey(movecapture, posTo);
+            addMaterial(movecapture);
         }
     } else if (move->s.type & 0xc) { //castle
         unPerformCastle(move->s.side, move->s.type);
     }
+    if (nnue) nnue->pop();
+    FULL_ASSERT(checkIncremental())
 }
 
 
@@ -323,28 +342,39 @@ bool GenMoves::makemove(const _Tmove *move, const bool rep, const bool checkInCh
         if ((move->s.type & 0x3) == PROMOTION_MOVE_MASK) {
             chessboard[pieceFrom] &= NOTPOW2[posFrom];
             updateZobristKey(pieceFrom, posFrom);
+            updatePawnKey(pieceFrom, posFrom);
+            removeMaterial(pieceFrom);
             ASSERT(move->s.promotionPiece >= 0)
             chessboard[(uchar) move->s.promotionPiece] |= POW2[posTo];
             updateZobristKey((uchar) move->s.promotionPiece, posTo);
+            addMaterial(move->s.promotionPiece);
         } else {
             chessboard[pieceFrom] = (chessboard[pieceFrom] | POW2[posTo]) & NOTPOW2[posFrom];
             updateZobristKey(pieceFrom, posFrom);
             updateZobristKey(pieceFrom, posTo);
+            if (pieceFrom <= PAWN_WHITE) {
+                updatePawnKey(pieceFrom, posFrom);
+                updatePawnKey(pieceFrom, posTo);
+            }
         }
         if (movecapture != SQUARE_EMPTY) {
             if ((move->s.type & 0x3) != ENPASSANT_MOVE_MASK) {
                 chessboard[movecapture] &= NOTPOW2[posTo];
                 updateZobristKey(movecapture, posTo);
+                if (movecapture <= PAWN_WHITE) updatePawnKey(movecapture, posTo);
             } else { //en passant
                 ASSERT(movecapture == (move->s.side ^ 1))
                 if (move->s.side) {
                     chessboard[movecapture] &= NOTPOW2[posTo - 8];
                     updateZobristKey(movecapture, posTo - 8);
+                    updatePawnKey(movecapture, posTo - 8);
                 } else {
                     chessboard[movecapture] &= NOTPOW2[posTo + 8];
                     updateZobristKey(movecapture, posTo + 8);
+                    updatePawnKey(movecapture, posTo + 8);
                 }
             }
+            removeMaterial(movecapture);
         }
         //lost castle right
         switch (pieceFrom) {
@@ -395,6 +425,8 @@ bool GenMoves::makemove(const _Tmove *move, const bool rep, const bool checkInCh
         const int position = BITScanForward(x2);
         updateZobristKey(14, position);
     }
+    if (nnue) nnue->push(chessboard);
+    FULL_ASSERT(checkIncremental())
     if (rep) {
         if (movecapture != SQUARE_EMPTY || pieceFrom == WHITE || pieceFrom == BLACK || move->s.type & 0xc) {
             pushStackMove(0);
@@ -412,11 +444,14 @@ bool GenMoves::makemove(const _Tmove *move, const bool rep, const bool checkInCh
 void GenMoves::init() {
     numMoves = numMovesq = listId = 0;
 #ifdef DEBUG_MODE
-    nCutFp = nCutRazor = 0;
+    nCutFp = nCutRazor = nCutSee = 0;
     betaEfficiency = 0.0;
     nCutAB = 0;
     nNullMoveCut = 0;
 #endif
+#ifdef STATS_MODE
+    nHashProbe = nHashHit = nHashCut = nEvalHashProbe = nEvalHashHit = nPawnHashProbe = nPawnHashHit = 0;
+#endif
 }
 
 u64 GenMoves::getTotMoves() const {
@@ -23,6 +23,7 @@
 #include "util/Bitboard.h"
 #include <vector>
 #include "namespaces/board.h"
+#include "nnue/NNUE.h"
 
 
 class GenMoves : public ChessBoard {
@@ -36,6 +37,13 @@ public:
 
     void setPerft(const bool b);
 
+    // the network evaluation replaces the classic one, the accumulators exist only while it's in use
+    void setUseNNUE(const bool b);
+
+    bool getUseNNUE() const {
+        return nnue != nullptr;
+    }
+
     bool generateCaptures(const int side, u64, u64);
 
     void generateMoves(const int side, const u64);
@@ -55,6 +63,27 @@ public:
         performKingShiftCapture<side>(~allpieces, false);
     }
 
+    /**
+     * pinned pieces and check mask of side, computed once for each node: with them pushmove emits only legal
+     * moves without makemove. Tagged with the zobrist key as the attack map
+     */
+    template<int side>
+    void setLegal(const u64 allpieces, const u64 friends) {
+        const u64 key = chessboard[ZOBRISTKEY_IDX] ^ _random::RANDSIDE[side];
+        if (legal.key == key) return;
+        legal.key = key;
+        const int kingPosition = BITScanForward(chessboard[KING_BLACK + side]);
+        legal.pinned = board::getPinned<side>(allpieces, friends, kingPosition, chessboard);
+        const u64 checkers = board::getAttackers<side, false>(kingPosition, allpieces, chessboard);
+        if (!checkers) {
+            legal.checkMask = 0xffffffffffffffffULL;
+        } else if (checkers & (checkers - 1)) {
+            legal.checkMask = 0;
+        } else {
+            legal.checkMask = checkers | LINK_SQUARE[kingPosition][BITScanForward(checkers)];
+        }
+    }
+
     template<int side>
     bool generateCaptures(const u64 enemies, const u64 friends) {
         ASSERT_RANGE(side, 0, 1);
@@ -62,10 +91,10 @@ public:
         ASSERT(chessboard[KING_WHITE]);
         const u64 allpieces = enemies | friends;
 
-        if (perftMode) {
-            int kingPosition = BITScanForward(chessboard[KING_BLACK + side]);
-            pinned = board::getPinned<side>(allpieces, friends, kingPosition, chessboard);
-            isInCheck = board::isAttacked<side>(kingPosition, allpieces, chessboard);
+        setLegal<side>(allpieces, friends);
+        if (!perftMode && isAttackMapValid() && (structureEval.attacksBySide[side] & chessboard[KING_BLACK + (side ^ 1)])) {
+            // the enemy king can be captured
+            return true;
         }
 
         if (performPawnCapture<side>(enemies)) {
@@ -159,9 +188,11 @@ public:
         BENCH(times->start("diagCapture"))
         ASSERT_RANGE(piece, 0, 11)
         ASSERT_RANGE(side, 0, 1)
+        const bool attackMap = isAttackMapValid();
         for (u64 x2 = chessboard[piece]; x2; RESET_LSB(x2)) {
             const int position = BITScanForward(x2);
-            u64 diag = getDiagonalAntiDiagonal(position, allpieces) & enemies;
+            u64 diag = (attackMap ? structureEval.diagAttacks[position] : getDiagonalAntiDiagonal(position, allpieces)) &
+                       enemies;
             for (; diag; RESET_LSB(diag)) {
                 if (pushmove<STANDARD_MOVE_MASK, side>(position, BITScanForward(diag), NO_PROMOTION, piece, true)) {
                     BENCH(times->stop("diagCapture"))
@@ -181,9 +212,11 @@ public:
         ASSERT_RANGE(piece, 0, 11)
         ASSERT_RANGE(side, 0, 1)
 
+        const bool attackMap = isAttackMapValid();
         for (u64 x2 = chessboard[piece]; x2; RESET_LSB(x2)) {
             const int position = BITScanForward(x2);
-            u64 rankFile = getRankFile(position, allpieces) & enemies;
+            u64 rankFile =
+                    (attackMap ? structureEval.rankFileAttacks[position] : getRankFile(position, allpieces)) & enemies;
             for (; rankFile; RESET_LSB(rankFile)) {
                 if (pushmove<STANDARD_MOVE_MASK, side>(position, BITScanForward(rankFile), NO_PROMOTION, piece, true)) {
                     BENCH(times->stop("rankFileCapture"))
@@ -395,16 +428,36 @@ public:
 
 
 #ifdef DEBUG_MODE
-    unsigned nCutAB, nNullMoveCut, nCutFp, nCutRazor;
+    unsigned nCutAB, nNullMoveCut, nCutFp, nCutRazor, nCutSee;
     double betaEfficiency;
 #endif
 
+#ifdef STATS_MODE
+    u64 nHashProbe, nHashHit, nHashCut, nEvalHashProbe, nEvalHashHit, nPawnHashProbe, nPawnHashHit;
+#endif
+
+#if defined(FULL_TEST)
+
+    // squares attacked by side, 0 if the attack map is not valid for this position
+    u64 getAttacksBySide(const int side) const {
+        return isAttackMapValid() ? structureEval.attacksBySide[side] : 0;
+    }
+
+#endif
 
     static constexpr int NO_PROMOTION = -1;
 protected:
 
-    u64 pinned;
+    // legality of the moves of a node, see setLegal
+    typedef struct {
+        u64 key;
+        u64 pinned;
+        u64 checkMask;  // destinations answering the check, all the squares if not in check, none in double check
+    } _Tlegal;
+
+    _Tlegal legal;
     bool perftMode;
+    NNUE *nnue = nullptr;
     int listId;
     _TmoveP *gen_list;
 
@@ -425,7 +478,295 @@ protected:
     u64 numMoves = 0;
     u64 numMovesq = 0;
 
-    _Tmove *getNextMove(decltype(gen_list), const int depth, const Hash::_ThashData *c, const int first);
+    _Tmove *getNextMove(decltype(gen_list), const int depth, const Hash::_ThashData *c, const int first) {
+        return getNextMove(gen_list, depth, c, first, gen_list->size);
+    }
+
+    // best move in [first, last) swapped to first
+    _Tmove *getNextMove(decltype(gen_list), const int depth, const Hash::_ThashData *c, const int first,
+                        const int last);
+
+    enum _Tstage : uchar {
+        STAGE_HASH, STAGE_GEN_CAPTURES, STAGE_GOOD_CAPTURES, STAGE_KILLERS, STAGE_GEN_QUIETS, STAGE_QUIETS,
+        STAGE_BAD_CAPTURES, STAGE_END
+    };
+
+    // state of the staged move picker of a node, indexed by listId
+    typedef struct {
+        _Tmove tried[4];    // hash move and killers, searched before the generation of their stage
+        u64 key;
+        u64 enpassant;
+        _Tlegal legal;      // children overwrite GenMoves::legal
+        unsigned short hashMove;
+        int depth;
+        int nTried;
+        int nMoves;
+        int next;
+        int nGood;          // good captures are [0, nGood), bad captures [nGood, nCaptures), then the quiets
+        int nCaptures;
+        int killer;
+        uchar stage;
+    } _TmovePicker;
+
+    _TmovePicker movePicker[MAX_PLY];
+
+    void initMovePicker(const Hash::_ThashData *hash, const int depth) {
+        _TmovePicker &picker = movePicker[listId];
+        picker.stage = STAGE_HASH;
+        picker.hashMove = hash ? (unsigned short) (hash->dataS.from | (hash->dataS.to << 8)) : 0;
+        picker.depth = depth;
+        picker.nTried = picker.nMoves = picker.killer = 0;
+        picker.key = chessboard[ZOBRISTKEY_IDX];
+        picker.enpassant = chessboard[ENPASSANT_IDX];
+    }
+
+    /**
+     * staged move picker, nothing is generated before it's needed:
+     * 1. hash move, validated on the board
+     * 2. captures not losing material (see)
+     * 3. killers, validated on the board
+     * 4. quiet moves
+     * 5. captures losing material
+     * the hash move and the killers are skipped when they are generated, all the moves are legal.
+     * The caller excludes the positions where the enemy king can be captured
+     */
+    template<int side>
+    _Tmove *getNextMove() {
+        _TmovePicker &picker = movePicker[listId];
+        _TmoveP *list = &gen_list[listId];
+        _Tmove *move;
+        switch (picker.stage) {
+            case STAGE_HASH:
+                picker.stage = STAGE_GEN_CAPTURES;
+                setLegal<side>(board::getBitmap<side>(chessboard) | board::getBitmap<side ^ 1>(chessboard),
+                               board::getBitmap<side>(chessboard));
+                picker.legal = legal;
+                if (picker.hashMove &&
+                    getLegalMove<side>(picker.hashMove & 0xff, picker.hashMove >> 8, false, picker.tried[0])) {
+                    // as the capture generation does, the takeback restores it
+                    if (chessboard[ENPASSANT_IDX] != NO_ENPASSANT) {
+                        updateZobristKey(13, chessboard[ENPASSANT_IDX]);
+                        chessboard[ENPASSANT_IDX] = NO_ENPASSANT;
+                    }
+                    picker.nTried = 1;
+                    picker.nMoves++;
+                    return &picker.tried[0];
+                }
+                // fallthrough
+            case STAGE_GEN_CAPTURES: {
+                chessboard[ZOBRISTKEY_IDX] = picker.key;
+                chessboard[ENPASSANT_IDX] = picker.enpassant;
+                legal = picker.legal;
+                generateCaptures<side>(board::getBitmap<side ^ 1>(chessboard), board::getBitmap<side>(chessboard));
+                picker.nCaptures = list->size;
+                picker.nGood = 0;
+                for (int i = 0; i < list->size; i++) {
+                    const _Tmove &m = list->moveList[i];
+                    if ((m.s.type & 0x3) == PROMOTION_MOVE_MASK || m.s.pieceFrom == KING_BLACK + side ||
+                        PIECES_VALUE[m.s.capturedPiece] >= PIECES_VALUE[m.s.pieceFrom] || see<side>(m) >= 0) {
+                        swap(list->moveList[i].u, list->moveList[picker.nGood++].u);
+                    }
+                }
+                picker.next = 0;
+                picker.stage = STAGE_GOOD_CAPTURES;
+            }
+                // fallthrough
+            case STAGE_GOOD_CAPTURES:
+                if ((move = pickMove(picker, picker.nGood))) return move;
+                picker.stage = STAGE_KILLERS;
+                // fallthrough
+            case STAGE_KILLERS:
+                legal = picker.legal;
+                while (picker.killer < 3) {
+                    // mate killer first
+                    constexpr int KILLER_ORDER[3] = {2, 0, 1};
+                    const unsigned short k = killer[KILLER_ORDER[picker.killer++]][picker.depth];
+                    _Tmove &m = picker.tried[picker.nTried];
+                    if (getLegalMove<side>(k & 0xff, k >> 8, true, m) && !isTried(picker, m)) {
+                        picker.nTried++;
+                        picker.nMoves++;
+                        return &m;
+                    }
+                }
+                picker.stage = STAGE_GEN_QUIETS;
+                // fallthrough
+            case STAGE_GEN_QUIETS:
+                ASSERT(list->size == picker.nCaptures)
+                legal = picker.legal;
+                generateMoves<side>(board::getBitmap<side>(chessboard) | board::getBitmap<side ^ 1>(chessboard));
+                picker.next = picker.nCaptures;
+                picker.stage = STAGE_QUIETS;
+                // fallthrough
+            case STAGE_QUIETS:
+                if ((move = pickMove(picker, list->size))) return move;
+                picker.next = picker.nGood;
+                picker.stage = STAGE_BAD_CAPTURES;
+                // fallthrough
+            case STAGE_BAD_CAPTURES:
+                if ((move = pickMove(picker, picker.nCaptures))) return move;
+                picker.stage = STAGE_END;
+                // fallthrough
+            default:
+                return nullptr;
+        }
+    }
+
+    _Tmove *pickMove(_TmovePicker &picker, const int last) {
+        while (picker.next < last) {
+            _Tmove *move = getNextMove(&gen_list[listId], picker.depth, nullptr, picker.next++, last);
+            if (!move) break;
+            if (!isTried(picker, *move)) {
+                picker.nMoves++;
+                return move;
+            }
+        }
+        return nullptr;
+    }
+
+    static bool isTried(const _TmovePicker &picker, const _Tmove &move) {
+        // the byte after the struct fields is not written by pushmove
+        for (int i = 0; i < picker.nTried; i++) {
+            if (!((picker.tried[i].u ^ move.u) & 0xffffffffffffffULL)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * the move from -> to of side as pushmove generates it, if it's legal in this position (setLegal).
+     * Castles and en passant are not recognized, a pawn on the 8th rank promotes to queen
+     */
+    template<int side>
+    bool getLegalMove(const int from, const int to, const bool quiet, _Tmove &move) {
+        if (from == to || from > 63 || to > 63) return false;
+        const u64 friends = board::getBitmap<side>(chessboard);
+        if (!(friends & POW2[from]) || (friends & POW2[to])) return false;
+        const int captured = board::getPieceAt<side ^ 1>(POW2[to], chessboard);
+        if (captured != SQUARE_EMPTY && (quiet || captured == KING_BLACK + (side ^ 1))) return false;
+        const int piece = board::getPieceAt<side>(POW2[from], chessboard);
+        const u64 allpieces = friends | board::getBitmap<side ^ 1>(chessboard);
+        const bool promotion = piece == PAWN_BLACK + side && (to > 55 || to < 8);
+        if (promotion && quiet) return false;
+        u64 targets;
+        switch (piece) {
+            case PAWN_BLACK + side: {
+                constexpr int push = side ? 8 : -8;
+                if (captured != SQUARE_EMPTY) {
+                    targets = PAWN_FORK_MASK[side][from];
+                } else if (to == from + push) {
+                    targets = POW2[to];
+                } else if (to == from + 2 * push && (POW2[from] & (side ? RANK_2 : RANK_7)) &&
+                           !(allpieces & POW2[from + push])) {
+                    targets = POW2[to];
+                } else {
+                    targets = 0;
+                }
+                break;
+            }
+            case KNIGHT_BLACK + side:
+                targets = KNIGHT_MASK[from];
+                break;
+            case BISHOP_BLACK + side:
+                targets = getDiagonalAntiDiagonal(from, allpieces);
+                break;
+            case ROOK_BLACK + side:
+                targets = getRankFile(from, allpieces);
+                break;
+            case QUEEN_BLACK + side:
+                targets = getDiagonalAntiDiagonal(from, allpieces) | getRankFile(from, allpieces);
+                break;
+            default:
+                targets = NEAR_MASK1[from];
+        }
+        if (!(targets & POW2[to])) return false;
+        if (promotion ? inCheck<PROMOTION_MOVE_MASK, side>(from, to, piece, captured, QUEEN_BLACK + side)
+                      : inCheck<STANDARD_MOVE_MASK, side>(from, to, piece, captured, NO_PROMOTION)) {
+            return false;
+        }
+        move.u = 0;
+        move.s.type = (uchar) chessboard[RIGHT_CASTLE_IDX] | (promotion ? PROMOTION_MOVE_MASK : STANDARD_MOVE_MASK);
+        move.s.side = (char) side;
+        move.s.capturedPiece = (uchar) captured;
+        move.s.from = (uchar) from;
+        move.s.to = (uchar) to;
+        move.s.pieceFrom = (char) piece;
+        move.s.promotionPiece = (char) (promotion ? QUEEN_BLACK + side : NO_PROMOTION);
+        return true;
+    }
+
+    /**
+     * static exchange evaluation of a capture: material balance of the captures on move.to, each side
+     * recaptures with its least valuable attacker or stops. The sliders behind a piece that leaves
+     * its square join the exchange (x-ray). The promotion bonus is not counted
+     */
+    template<int side>
+    int see(const _Tmove &move) const {
+        constexpr int LVA_ORDER[6] = {PAWN_BLACK, KNIGHT_BLACK, BISHOP_BLACK, ROOK_BLACK, QUEEN_BLACK, KING_BLACK};
+        const int to = move.s.to;
+        const u64 bitmap[2] = {board::getBitmap<BLACK>(chessboard), board::getBitmap<WHITE>(chessboard)};
+        u64 occupied = (bitmap[BLACK] | bitmap[WHITE]) & NOTPOW2[move.s.from];
+        if ((move.s.type & 0x3) == ENPASSANT_MOVE_MASK) {
+            occupied &= NOTPOW2[side ? to - 8 : to + 8];
+        }
+        const u64 diagonals = chessboard[BISHOP_BLACK] | chessboard[BISHOP_WHITE] | chessboard[QUEEN_BLACK] |
+                              chessboard[QUEEN_WHITE];
+        const u64 rankFiles = chessboard[ROOK_BLACK] | chessboard[ROOK_WHITE] | chessboard[QUEEN_BLACK] |
+                              chessboard[QUEEN_WHITE];
+        u64 attackers = board::getAttackers<BLACK, false>(to, occupied, chessboard) |
+                        board::getAttackers<WHITE, false>(to, occupied, chessboard);
+        int gain[40];
+        gain[0] = PIECES_VALUE[move.s.capturedPiece];
+        int piece = move.s.pieceFrom;
+        int d = 0;
+        for (int s = side ^ 1;; s ^= 1) {
+            ASSERT(d < 38);
+            d++;
+            // s captures piece
+            gain[d] = PIECES_VALUE[piece] - gain[d - 1];
+            if (max(-gain[d - 1], gain[d]) < 0) break;
+            attackers &= occupied;
+            const u64 own = attackers & bitmap[s];
+            if (!own) break;
+            u64 x = 0;
+            for (const int p:LVA_ORDER) {
+                if ((x = own & chessboard[p + s])) {
+                    piece = p + s;
+                    break;
+                }
+            }
+            occupied ^= x & -x;
+            if (piece == PAWN_BLACK + s || piece == BISHOP_BLACK + s || piece == QUEEN_BLACK + s) {
+                attackers |= Bitboard::getDiagonalAntiDiagonal(to, occupied) & diagonals;
+            }
+            if (piece == ROOK_BLACK + s || piece == QUEEN_BLACK + s) {
+                attackers |= Bitboard::getRankFile(to, occupied) & rankFiles;
+            }
+        }
+        while (--d) {
+            gain[d - 1] = -max(-gain[d - 1], gain[d]);
+        }
+        return gain[0];
+    }
+
+    bool isAttackMapValid() const {
+        return structureEval.attackKey == chessboard[ZOBRISTKEY_IDX];
+    }
+
+    // any square in sq attacked by the enemies of side
+    template<int side>
+    bool anyAttack(const u64 sq, const u64 allpieces) const {
+        if (isAttackMapValid()) {
+            return structureEval.attacksBySide[side ^ 1] & sq;
+        }
+        return board::anyAttack<side>(sq, allpieces, chessboard);
+    }
+
+    template<int side>
+    bool inCheck1() const {
+        if (isAttackMapValid()) {
+            return structureEval.attacksBySide[side ^ 1] & chessboard[KING_BLACK + side];
+        }
+        return board::inCheck1<side>(chessboard);
+    }
 
     template<int side>
     int getMobilityCastle(const u64 allpieces) const {
@@ -535,22 +876,20 @@ protected:
         ASSERT_RANGE(side, 0, 1);
         ASSERT_RANGE(pieceFrom, 0, 12);
         ASSERT_RANGE(pieceTo, 0, 12);
-        ASSERT(perftMode || forceCheck);
         ASSERT(!(type & 0xc));
-        if (perftMode) {
-
-            if ((KING_BLACK + side) != pieceFrom && !isInCheck) {
-                if (!(pinned & POW2[from]) || (LINES[from][to] & chessboard[KING_BLACK + side])) {
-                    ASSERT(!(inCheckSlow<side, type>(from, to, pieceFrom, pieceTo, promotionPiece)));
-                    BENCH(times->stop("inCheck"))
-                    return false;
-                } else {
-                    ASSERT ((inCheckSlow<side, type>(from, to, pieceFrom, pieceTo, promotionPiece)));
-                    BENCH(times->stop("inCheck"))
-                    return true;
-                }
+        if ((type & 0x3) != ENPASSANT_MOVE_MASK) {
+            bool res;
+            if ((KING_BLACK + side) == pieceFrom) {
+                // the king doesn't cover the squares behind it
+                res = board::isAttacked<side>(to, (board::getBitmap<BLACK>(chessboard) |
+                                                   board::getBitmap<WHITE>(chessboard)) & NOTPOW2[from], chessboard);
+            } else {
+                res = !(legal.checkMask & POW2[to]) ||
+                      ((legal.pinned & POW2[from]) && !(LINES[from][to] & chessboard[KING_BLACK + side]));
             }
-
+            ASSERT(res == (inCheckSlow<side, type>(from, to, pieceFrom, pieceTo, promotionPiece)));
+            BENCH(times->stop("inCheck"))
+            return res;
         }
 
         bool result = 0;
@@ -791,7 +1130,7 @@ protected:
         } else if (!(type & 0xc)) {//en passant
             piece_captured = side ^ 1;
         }
-        if (!(type & 0xc) && (forceCheck || perftMode)) {
+        if (!(type & 0xc)) {
             BENCH(times->subProcess("pushmove", "inCheck"))
             if (inCheck<type, side>(from, to, pieceFrom, piece_captured, promotionPiece)) {
                 BENCH(times->stop("pushmove"));
@@ -863,7 +1202,6 @@ protected:
 
 private:
     int running;
-    bool isInCheck;
     static bool forceCheck;
     static constexpr u64 TABJUMPPAWN = 0xFF00000000FF00ULL;
 
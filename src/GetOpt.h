@@ -20,6 +20,9 @@
 
 #include "util/Singleton.h"
 #include "perft/Perft.h"
+#include "IterativeDeeping.h"
+#include <chrono>
+#include <random>
 
 static const string
         PERFT_HELP = "-perft [-d depth] [-c nCpu] [-h hash size (mb) [-F dump file]] [-Chess960] [-f \"fen position\"]";
@@ -28,6 +31,9 @@ static const string WDL_GTB_HELP = "-wdl-gtb -f \"fen position\" -p path [-s sch
 static const string DTZ_SYZYGY_HELP = "-dtz-syzygy -f \"fen position\" -p path";
 static const string WDL_SYZYGY_HELP = "-wdl-syzygy -f \"fen position\" -p path";
 static const string PUZZLE_HELP = "-puzzle_epd -t K?K? ex: KRKP | KQKP | KBBKN | KQKR | KRKB | KRKN ...";
+static const string BENCH_EVAL_HELP = "-bench-eval file.epd [-n iterations]";
+static const string BENCH_HASH_HELP = "-bench-hash [-d depth]";
+static const string BENCH_EVAL_CACHE_HELP = "-bench-eval-cache [-d depth]";
 
 class GetOpt {
 
@@ -69,6 +75,14 @@ private:
     cout << "Oracle Solaris Studio "<<__SUNPRO_CC;
 #else
     cout << "Unknown compiler";
+#endif
+#ifdef CPU_DISPATCH
+        {
+            // the tables and the startup choice
+            Bitboard bitboard;
+            cout << "\n" << Cpu::getName() << ": " << Cpu::getFeatures() << "> sliders " << Bitboard::getSliderName()
+                 << ", nnue " << NNUE::getKernelName();
+        }
 #endif
         cout << "\nLicense GPLv3+: GNU GPL version 3 or later <http://gnu.org/licenses/gpl.html>\n\n";
 #ifdef CLOP
@@ -89,6 +103,9 @@ private:
         cout << "DTZ (syzygy):          " << exe << " " << DTZ_SYZYGY_HELP << endl;
         cout << "WDL (syzygy):          " << exe << " " << WDL_SYZYGY_HELP << endl;
         cout << "Generate puzzle epd:   " << exe << " " << PUZZLE_HELP << endl;
+        cout << "Eval benchmark:        " << exe << " " << BENCH_EVAL_HELP << endl;
+        cout << "Hash benchmark:        " << exe << " " << BENCH_HASH_HELP << endl;
+        cout << "Eval cache benchmark:  " << exe << " " << BENCH_EVAL_CACHE_HELP << endl;
     }
 
     static void perft(int argc, char **argv) {
@@ -194,6 +211,197 @@ private:
         searchManager.printDtmSyzygy();
     }
 
+    /**
+     * Eval::getScore speed on the positions of an epd (or fen) file, each position is evaluated n times
+     * with the eval cache always missing and then hitting. The checksum of the scores is the same in the
+     * two passes and changes only if the evaluation changes
+     */
+    static void benchEval(int argc, char **argv) {
+        if (string(optarg) != "ench-eval" || optind >= argc) {
+            cout << "use: " << argv[0] << " " << BENCH_EVAL_HELP << endl;
+            return;
+        }
+        const string fileName = argv[optind++];
+        int iterations = 100;
+        int opt;
+        while ((opt = getopt(argc, argv, "n:")) != -1) {
+            if (opt == 'n') {
+                iterations = max(1, atoi(optarg));
+            }
+        }
+        ifstream f(fileName);
+        if (!f.is_open()) {
+            cout << "error file " << fileName << " not found" << endl;
+            return;
+        }
+        // the epd operations after the position are skipped
+        vector<string> fens;
+        string line;
+        while (getline(f, line)) {
+            istringstream iss(line);
+            string pos, side, castle, enpassant;
+            if (iss >> pos >> side >> castle >> enpassant) {
+                fens.push_back(pos + " " + side + " " + castle + " " + enpassant + " 0 1");
+            }
+        }
+
+        constexpr int N_PHASES = 3;
+        const string PHASE_NAME[N_PHASES] = {"end game   ", "middle game", "opening    "};
+        unique_ptr<Eval> eval(new Eval());
+        for (int cached = 0; cached < 2; cached++) {
+            eval->setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+            u64 checksum = 0;
+            u64 nanoseconds[N_PHASES] = {0, 0, 0};
+            int positions[N_PHASES] = {0, 0, 0};
+            int skipped = 0;
+            for (const string &fen:fens) {
+                const _Tchessboard &chessboard = eval->getChessboard();
+                if (eval->ChessBoard::loadFen(fen) == 2 || !chessboard[KING_BLACK] || !chessboard[KING_WHITE]) {
+                    skipped++;
+                    continue;
+                }
+                const u64 key = chessboard[ZOBRISTKEY_IDX];
+                const int side = (int) chessboard[SIDETOMOVE_IDX];
+                const int phase = eval->getPhase() * N_PHASES / (Eval::PHASE_MAX + 1);
+                short score = 0;
+                const auto start = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    // another tag on the same slot never matches
+                    score = eval->getScore(cached ? key : key ^ ((u64) (i % 255 + 1) << 56), side, -_INFINITE,
+                                           _INFINITE, false);
+                }
+                nanoseconds[phase] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::high_resolution_clock::now() - start).count();
+                positions[phase]++;
+                checksum = checksum * 1000003 + (unsigned short) score;
+            }
+            u64 totNanoseconds = 0;
+            int totPositions = 0;
+            cout << "eval cache " << (cached ? "hit" : "miss") << ", " << iterations << " iterations";
+            if (skipped) cout << ", " << skipped << " bad positions skipped";
+            cout << "\n";
+            for (int phase = 0; phase < N_PHASES; phase++) {
+                cout << "  " << PHASE_NAME[phase] << " positions " << setw(8) << positions[phase] << "  ns/eval "
+                     << setw(10) << fixed << setprecision(1)
+                     << (positions[phase] ? (double) nanoseconds[phase] / ((double) positions[phase] * iterations) : 0)
+                     << "\n";
+                totNanoseconds += nanoseconds[phase];
+                totPositions += positions[phase];
+            }
+            cout << "  evals/sec " << (u64) ((double) totPositions * iterations * 1e9 / (double) max((u64) 1, totNanoseconds))
+                 << "  checksum " << hex << checksum << dec << endl;
+        }
+    }
+
+    static int searchMillisec(const string &fen, const int depth) {
+        IterativeDeeping it;
+        Singleton<SearchManager>::getInstance().setMaxTimeMillsec(100000000);
+        it.loadFen(fen);
+        it.setMaxDepth(depth);
+        const auto start = std::chrono::high_resolution_clock::now();
+        it.start();
+        it.join();
+        return Time::diffTime(std::chrono::high_resolution_clock::now(), start);
+    }
+
+    /**
+     * Hash::getIndex (multiply-high) against the modulo on 1M random keys and the time to depth with
+     * a non power of two hash size. With BENCH_MODE also the time to depth without and with the prefetch
+     */
+    static void benchHash(int argc, char **argv) {
+        int depth = 10;
+        int opt;
+        while ((opt = getopt(argc, argv, "d:")) != -1) {
+            if (opt == 'd') {
+                depth = max(1, atoi(optarg));
+            }
+        }
+        Hash &hash = Hash::getInstance();
+        std::mt19937_64 rnd(3);
+        vector<u64> keys(1 << 20);
+        for (u64 &k:keys) {
+            k = rnd();
+        }
+        for (const int mb:{64, 100}) {
+            hash.setHashSize(mb);
+            const u64 size = hash.getHashSize();
+            u64 sum = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const u64 k:keys) {
+                sum += k % size;
+            }
+            const double modulo = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            start = std::chrono::high_resolution_clock::now();
+            for (const u64 k:keys) {
+                sum += hash.getIndex(k);
+            }
+            const double mulHigh = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::high_resolution_clock::now() - start).count();
+            cout << "hash " << mb << " MB: modulo " << modulo / keys.size() << " ns/index, multiply-high "
+                 << mulHigh / keys.size() << " ns/index (" << sum % 10 << ")" << endl;
+            hash.clearHash();
+            const int ms = searchMillisec("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                                          depth);
+            cout << "hash " << mb << " MB: depth " << depth << " in " << ms << " ms" << endl;
+        }
+#ifdef BENCH_MODE
+        // the prefetch can be switched off only in the bench build
+        hash.setHashSize(512);
+        int ms[2];
+        for (int prefetch = 0; prefetch < 2; prefetch++) {
+            hash.setPrefetch(prefetch);
+            ms[prefetch] = 0;
+            for (const string fen:{"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                                   "r3n1k1/1p1b1ppp/p2rp3/4B3/q1P2P2/3B4/PP3QPP/R2R2K1 b - - 5 23"}) {
+                hash.clearHash();
+                ms[prefetch] += searchMillisec(fen, depth - 1);
+            }
+        }
+        cout << "hash 512 MB: prefetch off " << ms[0] << " ms, on " << ms[1] << " ms" << endl;
+#endif
+    }
+
+    /**
+     * time to depth with 1 and 16 MB of eval cache per thread on 1, 2 and 4 threads. With BENCH_MODE also with one
+     * cache of the same size shared by all the threads, the layout before the per-thread caches
+     */
+    static void benchEvalCache(int argc, char **argv) {
+        int depth = 12;
+        int opt;
+        while ((opt = getopt(argc, argv, "d:")) != -1) {
+            if (opt == 'd') {
+                depth = max(1, atoi(optarg));
+            }
+        }
+        SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+#ifdef BENCH_MODE
+        constexpr int N_LAYOUTS = 2;
+#else
+        constexpr int N_LAYOUTS = 1;
+#endif
+        const string LAYOUT_NAME[2] = {"per thread", "shared"};
+        for (const int mb:{1, 16}) {
+            for (const int nThread:{1, 2, 4}) {
+                int ms[N_LAYOUTS];
+                for (int layout = 0; layout < N_LAYOUTS; layout++) {
+                    searchManager.setNthread(nThread);
+                    searchManager.setEvalHashSize(mb);
+#ifdef BENCH_MODE
+                    if (layout) searchManager.shareEvalHash();
+#endif
+                    Hash::getInstance().clearHash();
+                    ms[layout] = searchMillisec("r3n1k1/1p1b1ppp/p2rp3/4B3/q1P2P2/3B4/PP3QPP/R2R2K1 b - - 5 23", depth);
+                }
+                cout << "eval cache " << mb << " MB, threads " << nThread << ", depth " << depth << " in";
+                for (int layout = 0; layout < N_LAYOUTS; layout++) {
+                    cout << (layout ? ", " : " ") << ms[layout] << " ms " << LAYOUT_NAME[layout];
+                }
+                cout << endl;
+            }
+        }
+    }
+
 public:
 
     static void parse(int argc, char **argv) {
@@ -239,6 +447,17 @@ public:
                         return;
                     }
                     return;
+                } else if (opt == 'b') {
+                    if (string(optarg) == "ench-hash") {
+                        benchHash(argc, argv);
+                        return;
+                    }
+                    if (string(optarg) == "ench-eval-cache") {
+                        benchEvalCache(argc, argv);
+                        return;
+                    }
+                    benchEval(argc, argv);
+                    return;
                 } else if (opt == 'w') {
                     if (string(optarg) == "dl-gtb") {
                         dtmWdlGtb(argc, argv, false);
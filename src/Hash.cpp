@@ -18,10 +18,28 @@
 
 #include <mutex>
 #include "Hash.h"
+#include "util/FileUtil.h"
+
+#ifdef HAS_MMAP
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+static constexpr char HASH_FILE_MAGIC[8] = "CINHASH";
 
 Hash::Hash() {
     HASH_SIZE = 0;
-    hashArray[HASH_ALWAYS] = hashArray[HASH_GREATER] = nullptr;
+    hashMemory.type = Memory::ALLOC_NONE;
+    hashArray = nullptr;
+    nThread = 1;
+    localGeneration = 1;
+    generation = &localGeneration;
+#ifdef BENCH_MODE
+    prefetchEnabled = true;
+#endif
 #ifdef DEBUG_MODE
     n_cut_hashA = n_cut_hashB = cutFailed = probeHash = readCollisions = 0;
     nRecordHashA = nRecordHashB = nRecordHashE = collisions = 0;
@@ -30,47 +48,268 @@ Hash::Hash() {
 
 }
 
-void Hash::clearAge() {
-    for (unsigned i = 0; i < HASH_SIZE; i++) {
-        hashArray[HASH_ALWAYS][i].u.dataS.entryAge = 0;
+// runs f(from, to) on min(nThread, n) contiguous slices of [0, n), one thread per slice
+template<class F>
+static void parallelSlices(const int nThread, const unsigned n, F f) {
+    const unsigned nSlice = min((unsigned) nThread, n);
+    if (!nSlice) {
+        return;
+    }
+    const unsigned slice = n / nSlice;
+#ifdef JS_MODE
+    for (unsigned i = 0; i < nSlice; i++) {
+        f(i * slice, i == nSlice - 1 ? n : (i + 1) * slice);
+    }
+#else
+    vector<thread> workers;
+    for (unsigned i = 1; i < nSlice; i++) {
+        workers.push_back(thread(f, i * slice, i == nSlice - 1 ? n : (i + 1) * slice));
     }
+    f(0, nSlice == 1 ? n : slice);
+    for (thread &t:workers) {
+        t.join();
+    }
+#endif
 }
 
 void Hash::clearHash() {
-    if (!HASH_SIZE) {
+    // each thread zeroes its own slice, the first touch spreads the pages on the NUMA nodes
+    parallelSlices(nThread, HASH_SIZE, [this](const unsigned from, const unsigned to) {
+        memset(static_cast<void *>(hashArray + from), 0, sizeof(_Tbucket) * (to - from));
+    });
+}
+
+void Hash::rehash(const _Tbucket *oldArray, const unsigned oldSize) {
+    // the index is monotonic in the key, so the slices of the old table land in (almost) disjoint
+    // ranges of the new one, a torn entry on the boundaries fails the key check like in the search
+    parallelSlices(nThread, oldSize, [this, oldArray](const unsigned from, const unsigned to) {
+        for (unsigned i = from; i < to; i++) {
+            for (int j = 0; j < BUCKET_SIZE; j++) {
+                const _Thash *e = &oldArray[i].entry[j];
+                if (!e->u.dataU) {
+                    continue;
+                }
+                _Tbucket *bucket = &hashArray[getIndex(e->key ^ e->u.dataU)];
+                // keep the deepest entries when the table shrinks
+                _Thash *replace = &bucket->entry[0];
+                if (j) {
+                    replace = &bucket->entry[1];
+                    for (int k = 2; k < BUCKET_SIZE && replace->u.dataU; k++) {
+                        if (!bucket->entry[k].u.dataU || bucket->entry[k].u.dataS.depth < replace->u.dataS.depth) {
+                            replace = &bucket->entry[k];
+                        }
+                    }
+                }
+                if (!replace->u.dataU || replace->u.dataS.depth < e->u.dataS.depth) {
+                    *replace = *e;
+                }
+            }
+        }
+    });
+}
+
+void Hash::getSampleStats(int &usedPermill, int &greaterUsedPermill, int &oldPermill, int &meanAge) const {
+    usedPermill = greaterUsedPermill = oldPermill = meanAge = 0;
+    const unsigned n = HASH_SIZE < SAMPLE_BUCKETS ? HASH_SIZE : SAMPLE_BUCKETS;
+    if (!n) {
         return;
     }
-    memset(static_cast<void*>(hashArray[HASH_GREATER]), 0, sizeof(_Thash) * HASH_SIZE);
-    memset(static_cast<void*>(hashArray[HASH_ALWAYS]), 0, sizeof(_Thash) * HASH_SIZE);
+    int used = 0, greaterUsed = 0, old = 0, age = 0;
+    for (unsigned i = 0; i < n; i++) {
+        for (int j = 0; j < BUCKET_SIZE; j++) {
+            const _Thash *e = &hashArray[i].entry[j];
+            if (!e->u.dataU) {
+                continue;
+            }
+            used++;
+            greaterUsed += j == 0;
+            const int relativeAge = getRelativeAge(e);
+            if (relativeAge) {
+                old++;
+                age += relativeAge;
+            }
+        }
+    }
+    usedPermill = used * 1000 / (n * BUCKET_SIZE);
+    greaterUsedPermill = greaterUsed * 1000 / n;
+    oldPermill = used ? old * 1000 / used : 0;
+    meanAge = old ? age / old : 0;
 }
 
 void Hash::setHashSize(int mb) {
-    dispose();
+    resize(mb, true);
+}
+
+void Hash::resize(const int mb, const bool keepEntries) {
+    // the old table is kept until its entries are moved in the new one
+    Memory::_Tmemory oldMemory = hashMemory;
+    const _Tbucket *oldArray = hashArray;
+    const unsigned oldSize = HASH_SIZE;
+    localGeneration = *generation;
+    generation = &localGeneration;
+    hashMemory.type = Memory::ALLOC_NONE;
+    hashArray = nullptr;
+    HASH_SIZE = 0;
     if (mb > 0) {
-        u64 tmp = (u64)mb * 1024 * 1024 / (sizeof(_Thash) * 2);
-        hashArray[HASH_ALWAYS] = (_Thash *) calloc(tmp, sizeof(_Thash));
-        if (!hashArray[HASH_ALWAYS]) {
-            fatal("info string error - no memory");
-            exit(1);
+        u64 tmp = min((u64) mb * 1024 * 1024 / sizeof(_Tbucket), (u64) 0xffffffff);
+        bool created = true;
+        _TsharedState *sharedState = nullptr;
+        if (!sharedName.empty()) {
+            if (Memory::allocShared(hashMemory, sharedName, (tmp + 1) * sizeof(_Tbucket), created) &&
+                hashMemory.size >= 2 * sizeof(_Tbucket)) {
+                sharedState = (_TsharedState *) hashMemory.ptr;
+                const u64 n = min(hashMemory.size / sizeof(_Tbucket) - 1, (u64) 0xffffffff);
+                if (n != tmp) {
+                    cout << "info string shared hash " << sharedName << " is " << (n * sizeof(_Tbucket) >> 20)
+                         << " MB, requested " << mb << " MB" << endl;
+                }
+                tmp = n;
+            } else {
+                Memory::dealloc(hashMemory);
+                created = true;
+                cout << "info string error - shared memory " << sharedName << " not available" << endl;
+            }
         }
-        hashArray[HASH_GREATER] = (_Thash *) calloc(tmp, sizeof(_Thash));
-        if (!hashArray[HASH_GREATER]) {
+        if (hashMemory.type == Memory::ALLOC_NONE &&
+            !Memory::alloc(hashMemory, tmp * sizeof(_Tbucket), sizeof(_Tbucket))) {
             fatal("info string error - no memory");
             exit(1);
         }
+        hashArray = (_Tbucket *) hashMemory.ptr;
+        if (sharedState) {
+            hashArray++;
+            generation = &sharedState->generation;
+        }
         HASH_SIZE = tmp;
+        if (created) {
+            // an attached shared table keeps the entries and the generation of the other processes
+            *generation = localGeneration;
+            clearHash();
+            if (keepEntries) {
+                rehash(oldArray, oldSize);
+            }
+            Memory::publishShared(hashMemory);
+        }
     }
+    Memory::dealloc(oldMemory);
 }
 
-void Hash::dispose() {
-    if (hashArray[HASH_ALWAYS] != nullptr) {
-        free(hashArray[HASH_ALWAYS]);
+u64 Hash::checksum(const _Tbucket *buckets, const u64 n) {
+    const u64 *p = (const u64 *) buckets;
+    u64 res = 0xcbf29ce484222325ULL;
+    for (u64 i = 0; i < n * sizeof(_Tbucket) / sizeof(u64); i++) {
+        res = (res ^ p[i]) * 0x100000001b3ULL;
     }
-    if (hashArray[HASH_GREATER] != nullptr) {
-        free(hashArray[HASH_GREATER]);
-    }
-    hashArray[HASH_ALWAYS] = hashArray[HASH_GREATER] = nullptr;
-    HASH_SIZE = 0;
+    return res;
 }
 
+bool Hash::dump(const string &fileName) {
+    if (!HASH_SIZE) {
+        return false;
+    }
+    _ThashFileHeader header;
+    memset(static_cast<void *>(&header), 0, sizeof(header));
+    memcpy(header.magic, HASH_FILE_MAGIC, sizeof(header.magic));
+    header.version = HASH_FILE_VERSION;
+    header.bucketSize = sizeof(_Tbucket);
+    header.nBuckets = HASH_SIZE;
+    header.checksum = checksum(hashArray, HASH_SIZE);
+    header.generation = *generation;
+
+    const string tmpFile = fileName + ".tmp";
+    ofstream f;
+    f.open(tmpFile, ios_base::out | ios_base::binary);
+    if (!f.is_open()) {
+        cout << "info string error create file " << tmpFile << endl;
+        return false;
+    }
+    f.write(reinterpret_cast<char *>(&header), sizeof(header));
+    f.write(reinterpret_cast<char *>(hashArray), (u64) HASH_SIZE * sizeof(_Tbucket));
+    f.close();
+    if (f.fail() || rename(tmpFile.c_str(), fileName.c_str())) {
+        cout << "info string error write file " << fileName << endl;
+        return false;
+    }
+    return true;
+}
 
+bool Hash::load(const string &fileName) {
+    if (isShared()) {
+        cout << "info string error the shared hash can't be loaded" << endl;
+        return false;
+    }
+    if (!FileUtil::fileExists(fileName)) {
+        cout << "info string error file " << fileName << " not found" << endl;
+        return false;
+    }
+    _ThashFileHeader header;
+    const char *data = nullptr;
+    u64 fileSize = 0;
+#ifdef HAS_MMAP
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    fileSize = lseek(fd, 0, SEEK_END);
+    void *map = fileSize >= sizeof(header) ? mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        cout << "info string error read file " << fileName << endl;
+        return false;
+    }
+    madvise(map, fileSize, MADV_SEQUENTIAL);
+    data = (const char *) map;
+#else
+    ifstream f(fileName, ios_base::in | ios_base::binary | ios_base::ate);
+    const streamoff end = f.is_open() ? (streamoff) f.tellg() : -1;
+    if (end < (streamoff) sizeof(header)) {
+        cout << "info string error read file " << fileName << endl;
+        return false;
+    }
+    fileSize = end;
+    f.seekg(0);
+    char *buffer = (char *) malloc(fileSize);
+    if (!buffer) {
+        return false;
+    }
+    f.read(buffer, fileSize);
+    f.close();
+    if (!f) {
+        cout << "info string error read file " << fileName << endl;
+        free(buffer);
+        return false;
+    }
+    data = buffer;
+#endif
+    bool res = false;
+    memcpy(&header, data, min((u64) sizeof(header), fileSize));
+    const _Tbucket *buckets = (const _Tbucket *) (data + sizeof(header));
+    // nBuckets is bounded before the multiplication
+    constexpr u64 BUCKETS_MB = 1024 * 1024 / sizeof(_Tbucket);
+    if (fileSize < sizeof(header) || memcmp(header.magic, HASH_FILE_MAGIC, sizeof(header.magic)) ||
+        header.version != HASH_FILE_VERSION || header.bucketSize != sizeof(_Tbucket) ||
+        header.nBuckets > (fileSize - sizeof(header)) / sizeof(_Tbucket) ||
+        fileSize != sizeof(header) + header.nBuckets * sizeof(_Tbucket)) {
+        cout << "info string error " << fileName << " is not a compatible hash file" << endl;
+    } else if (!header.nBuckets || header.nBuckets % BUCKETS_MB || header.nBuckets > 0xffffffff) {
+        // setHashSize can't allocate it
+        cout << "info string error hash size " << header.nBuckets << " buckets" << endl;
+    } else if (checksum(buckets, header.nBuckets) != header.checksum) {
+        cout << "info string error " << fileName << " checksum mismatch" << endl;
+    } else {
+        if (header.nBuckets != HASH_SIZE) {
+            // the entries are overwritten, no rehash
+            resize(header.nBuckets / BUCKETS_MB, false);
+        }
+        ASSERT(header.nBuckets == HASH_SIZE);
+        memcpy(static_cast<void *>(hashArray), buckets, (u64) HASH_SIZE * sizeof(_Tbucket));
+        *generation = header.generation;
+        res = true;
+    }
+#ifdef HAS_MMAP
+    munmap((void *) data, fileSize);
+#else
+    free((void *) data);
+#endif
+    return res;
+}
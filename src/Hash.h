@@ -24,8 +24,14 @@
 #include "namespaces/constants.h"
 #include "util/Singleton.h"
 #include "util/logger.h"
+#include "util/Memory.h"
 #include "threadPool/Spinlock.h"
 #include <mutex>
+#include <climits>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <fstream>
 
 using namespace constants;
 using namespace _logger;
@@ -37,6 +43,8 @@ public:
 
     static constexpr int HASH_ALWAYS = 1;
     static constexpr int HASH_GREATER = 0;
+    static constexpr int BUCKET_SIZE = 4;
+    static constexpr unsigned SAMPLE_BUCKETS = 250;
 
     typedef union _ThashData {
         u64 dataU;
@@ -46,7 +54,7 @@ public:
             char depth;
             uchar from;
             uchar to;
-            uchar entryAge;
+            uchar entryAge; // search generation of the entry
             uchar flags;
 
             __dataS() {};
@@ -68,10 +76,28 @@ public:
         _ThashData u;
     } _Thash;
 
+    // one cache line: entry[0] is the depth-preferred slot (HASH_GREATER),
+    // entry[1..BUCKET_SIZE-1] are the always-replace slots (HASH_ALWAYS)
+    typedef struct alignas(64) {
+        _Thash entry[BUCKET_SIZE];
+    } _Tbucket;
+
     enum : char {
         hashfALPHA = 0, hashfEXACT = 1, hashfBETA = 2
     };
 
+    // increment when _Thash or _Tbucket layout changes
+    static constexpr unsigned HASH_FILE_VERSION = 1;
+
+    typedef struct {
+        char magic[8];
+        unsigned version;
+        unsigned bucketSize;
+        u64 nBuckets;
+        u64 checksum;
+        uchar generation;
+    } _ThashFileHeader;
+
 #ifdef DEBUG_MODE
     unsigned nRecordHashA, nRecordHashB, nRecordHashE, collisions, readCollisions;
 
@@ -80,34 +106,110 @@ public:
 
     void setHashSize(int mb);
 
+    unsigned getHashSize() const {
+        return HASH_SIZE;
+    }
+
+    int getHashSizeMb() const {
+        return (u64) HASH_SIZE * sizeof(_Tbucket) >> 20;
+    }
+
+    const char *getAllocType() const {
+        return Memory::getTypeName(hashMemory.type);
+    }
+
+    // permill of the entries of a fixed sample written by the current search (UCI hashfull)
+    int getHashfull() const {
+        if (!HASH_SIZE) {
+            return 0;
+        }
+        const unsigned n = HASH_SIZE < SAMPLE_BUCKETS ? HASH_SIZE : SAMPLE_BUCKETS;
+        int count = 0;
+        for (unsigned i = 0; i < n; i++) {
+            for (int j = 0; j < BUCKET_SIZE; j++) {
+                const _Thash *e = &hashArray[i].entry[j];
+                count += e->u.dataU && !getRelativeAge(e);
+            }
+        }
+        return count * 1000 / (n * BUCKET_SIZE);
+    }
+
+    void getSampleStats(int &usedPermill, int &greaterUsedPermill, int &oldPermill, int &meanAge) const;
+
+    // name of the POSIX shared memory object holding the table, empty for a private table
+    void setSharedName(const string &name) {
+        sharedName = name;
+    }
+
+    // a killed engine never detaches: its shared memory object outlives every engine, the next ones attach to
+    // it, until this removes it (Shared Hash Unlink, see Memory::allocShared)
+    bool unlinkShared() const {
+        return Memory::unlinkShared(sharedName);
+    }
+
+    bool isShared() const {
+        return hashMemory.type == Memory::ALLOC_SHARED;
+    }
+
+    // multiply-high range reduction of the upper 32 bits of the key: no divide and any table size,
+    // a power of two size reduces to the top bits of the key
+    inline unsigned getIndex(const u64 zobristKey) const {
+        return ((zobristKey >> 32) * HASH_SIZE) >> 32;
+    }
+
     void clearHash();
 
-    void clearAge();
+    bool dump(const string &fileName);
+
+    bool load(const string &fileName);
+
+    inline void prefetch(const u64 zobristKey) const {
+        __builtin_prefetch(&hashArray[getIndex(zobristKey)]);
+    }
+
+#ifdef BENCH_MODE
+
+    bool getPrefetch() const {
+        return prefetchEnabled;
+    }
+
+    void setPrefetch(const bool b) {
+        prefetchEnabled = b;
+    }
+
+#endif
+
+    void setNthread(const int n) {
+        nThread = max(1, n);
+    }
+
+    void newGeneration() {
+        if (!++*generation) {
+            *generation = 1;
+        }
+    }
 
     u64 readHash(const int type, const u64 zobristKeyR)
 #ifndef DEBUG_MODE
     const
 #endif
     {
-        const _Thash *hash = &(hashArray[type][zobristKeyR % HASH_SIZE]);
-        const u64 data = hash->u.dataU;
-        const u64 k = hash->key;
-        if (zobristKeyR == (k ^ data)) {
-            return data;
+        const _Tbucket *bucket = &hashArray[getIndex(zobristKeyR)];
+        if (type == HASH_GREATER) {
+            return readEntry(&bucket->entry[0], zobristKeyR);
+        }
+        for (int i = 1; i < BUCKET_SIZE; i++) {
+            const u64 data = readEntry(&bucket->entry[i], zobristKeyR);
+            if (data) {
+                return data;
+            }
         }
-
-        DEBUG(if (data) readCollisions++)
-
         return 0;
     }
 
     void recordHash(const u64 zobristKey, _ThashData &tmp) {
         ASSERT(zobristKey);
-        const unsigned kMod = zobristKey % HASH_SIZE;
-        _Thash *rootHashG = &(hashArray[HASH_ALWAYS][kMod]);
-
-        rootHashG->key = (zobristKey ^ tmp.dataU);
-        rootHashG->u.dataU = tmp.dataU;
+        _Tbucket *bucket = &hashArray[getIndex(zobristKey)];
 
 #ifdef DEBUG_MODE
         if (tmp.dataS.flags == hashfALPHA) {
@@ -118,21 +220,49 @@ public:
             nRecordHashE++;
         }
 #endif
+        tmp.dataS.entryAge = *generation;
+
+        // always-replace: same key, otherwise the shallowest entry, entries of older searches first
+        _Thash *replace = &bucket->entry[1];
+        int replaceValue = INT_MAX;
+        for (int i = 1; i < BUCKET_SIZE; i++) {
+            _Thash *e = &bucket->entry[i];
+            if (zobristKey == (e->key ^ e->u.dataU)) {
+                replace = e;
+                break;
+            }
+            const int value = e->u.dataS.depth - 8 * getRelativeAge(e);
+            if (value < replaceValue) {
+                replaceValue = value;
+                replace = e;
+            }
+        }
+        replace->key = (zobristKey ^ tmp.dataU);
+        replace->u.dataU = tmp.dataU;
 
-        _Thash *rootHashA = &(hashArray[HASH_GREATER][kMod]);
+        _Thash *greater = &bucket->entry[0];
 
-        DEBUG(if (rootHashA->u.dataU) INC(collisions))
+        DEBUG(if (greater->u.dataU) INC(collisions))
 
-        if (rootHashA->u.dataS.depth >= tmp.dataS.depth && rootHashA->u.dataS.entryAge) {
+        if (greater->u.dataS.depth >= tmp.dataS.depth && !getRelativeAge(greater)) {
             return;
         }
-        tmp.dataS.entryAge = 1;
-        rootHashA->key = (zobristKey ^ tmp.dataU);
-        rootHashA->u.dataU = tmp.dataU;
+        greater->key = (zobristKey ^ tmp.dataU);
+        greater->u.dataU = tmp.dataU;
+    }
+
+    ~Hash() {
+        // the processes may still search, the table stays mapped until the exit
+        Memory::detachShared(hashMemory);
     }
 
 private:
     Hash();
+
+    // first bucket of a shared table, the generation is common to all the processes attached
+    typedef struct alignas(64) {
+        uchar generation;
+    } _TsharedState;
     unsigned HASH_SIZE;
 #ifdef JS_MODE
     static constexpr int HASH_SIZE_DEFAULT = 1;
@@ -140,8 +270,43 @@ private:
     static constexpr int HASH_SIZE_DEFAULT = 64;
 #endif
 
-    void dispose();
+    int nThread;
+    // localGeneration or the one of the shared table
+    uchar *generation;
+    uchar localGeneration;
+    string sharedName;
+#ifdef BENCH_MODE
+    bool prefetchEnabled;
+#endif
+
+    void rehash(const _Tbucket *oldArray, const unsigned oldSize);
+
+    // keepEntries: the entries of the old table are moved in the new one
+    void resize(const int mb, const bool keepEntries);
+
+    static u64 checksum(const _Tbucket *buckets, const u64 n);
+
+    inline uchar getRelativeAge(const _Thash *hash) const {
+        return *generation - hash->u.dataS.entryAge;
+    }
+
+    inline u64 readEntry(const _Thash *hash, const u64 zobristKeyR)
+#ifndef DEBUG_MODE
+    const
+#endif
+    {
+        const u64 data = hash->u.dataU;
+        const u64 k = hash->key;
+        if (zobristKeyR == (k ^ data)) {
+            return data;
+        }
+
+        DEBUG(if (data) readCollisions++)
+
+        return 0;
+    }
 
-    _Thash *hashArray[2];
+    Memory::_Tmemory hashMemory;
+    _Tbucket *hashArray;
 };
 
@@ -111,7 +111,7 @@ void IterativeDeeping::run() {
 
     searchManager.startClock();
     searchManager.clearHeuristic();
-    hash.clearAge();
+    hash.newGeneration();
     searchManager.setForceCheck(false);
 
     auto start1 = std::chrono::high_resolution_clock::now();
@@ -175,6 +175,7 @@ void IterativeDeeping::run() {
         int LazyEvalCuts = searchManager.getLazyEvalCuts();
         int nCutFp = searchManager.getNCutFp();
         int nCutRazor = searchManager.getNCutRazor();
+        int nCutSee = searchManager.getNCutSee();
 
         int collisions = hash.collisions;
         unsigned readCollisions = hash.readCollisions;
@@ -192,6 +193,7 @@ void IterativeDeeping::run() {
         cout << "info string lazy eval cut: " << LazyEvalCuts << endl;
         cout << "info string futility pruning cut: " << nCutFp << endl;
         cout << "info string razor cut: " << nCutRazor << endl;
+        cout << "info string see cut: " << nCutSee << endl;
         cout << "info string null move cut: " << nNullMoveCut << endl;
 
         cout << "info string hash write collisions : " << collisions * 100 / totStoreHash << "%" << endl;
@@ -229,6 +231,7 @@ void IterativeDeeping::run() {
             }
             cout << " time " << timeTaken << " nodes " << totMoves;
             if (timeTaken)cout << " nps " << (int) ((double) totMoves / (double) timeTaken * 1000.0);
+            cout << " hashfull " << hash.getHashfull();
             cout << " pv " << pvv << endl;
         }
 
@@ -249,6 +252,24 @@ void IterativeDeeping::run() {
         }
     }
 
+#ifdef STATS_MODE
+    u64 hashProbe, hashHit, hashCut;
+    searchManager.getHashStats(hashProbe, hashHit, hashCut);
+    int used, greaterUsed, old, meanAge;
+    hash.getSampleStats(used, greaterUsed, old, meanAge);
+    cout << "info string hash probe " << hashProbe << " hit " << hashHit * 100 / (hashProbe + 1) << "% cut "
+         << hashCut * 100 / (hashProbe + 1) << "%" << endl;
+    cout << "info string hash sample used " << used / 10 << "% depth-preferred used " << greaterUsed / 10
+         << "% old " << old / 10 << "% mean age " << meanAge << endl;
+    u64 evalProbe, evalHit;
+    searchManager.getEvalHashStats(evalProbe, evalHit);
+    cout << "info string eval cache " << searchManager.getEvalHashSize() << " MB per thread, probe " << evalProbe
+         << " hit " << evalHit * 100 / (evalProbe + 1) << "%" << endl;
+    u64 pawnProbe, pawnHit;
+    searchManager.getPawnHashStats(pawnProbe, pawnHit);
+    cout << "info string pawn hash probe " << pawnProbe << " hit " << pawnHit * 100 / (pawnProbe + 1) << "%" << endl;
+#endif
+
 #ifdef BENCH_MODE
 
     Times *times = &Times::getInstance();
@@ -77,6 +77,10 @@ Search::Search() : ponder(false), nullSearch(false) {
 
 void Search::clone(const Search *s) {
     memcpy(chessboard, s->chessboard, sizeof(_Tchessboard));
+    pawnKey = s->pawnKey;
+    materialKey = s->materialKey;
+    material[BLACK] = s->material[BLACK];
+    material[WHITE] = s->material[WHITE];
 }
 
 #ifndef JS_MODE
@@ -319,10 +323,14 @@ int Search::quiescence(int alpha, const int beta, const char promotionPiece, con
     int first = 0;
     if (!(numMoves % 2048)) setRunning(checkTime());
     while ((move = getNextMove(&gen_list[listId], depth, c, first++))) {
-        if (!makemove(move, false, true)) {
-            takeback(move, oldKey, false);
+/**************SEE Pruning ****************/
+        if ((move->s.type & 0x3) != PROMOTION_MOVE_MASK &&
+            PIECES_VALUE[move->s.capturedPiece] < PIECES_VALUE[move->s.pieceFrom] && see<side>(*move) < 0) {
+            INC(nCutSee);
             continue;
         }
+/************ end SEE Pruning *************/
+        makemove(move, false, false);
 /**************Delta Pruning ****************/
         if (fprune && ((move->s.type & 0x3) != PROMOTION_MOVE_MASK) &&
             fscore + PIECES_VALUE[move->s.capturedPiece] <= alpha) {
@@ -331,6 +339,7 @@ int Search::quiescence(int alpha, const int beta, const char promotionPiece, con
             continue;
         }
 /************ end Delta Pruning *************/
+        prefetchChild(chessboard[ZOBRISTKEY_IDX] ^ _random::RANDSIDE[side ^ 1], true);
         int val = -quiescence<side ^ 1>(-beta, -alpha, move->s.promotionPiece, depth - 1);
         score = max(score, val);
         takeback(move, oldKey, false);
@@ -757,10 +766,10 @@ int Search::search(int depth, int alpha, const int beta, _TpvLine *pline, const
     ASSERT(chessboard[KING_WHITE])
 
     int extension = 0;
-    const int is_incheck_side = board::inCheck1<side>(chessboard);
+    const int is_incheck_side = inCheck1<side>();
     if (!is_incheck_side && depth != mainDepth) {
-        if (board::checkInsufficientMaterial(N_PIECE, chessboard) || checkDraw(chessboard[ZOBRISTKEY_IDX])) {
-            if (board::inCheck1<side ^ 1>(chessboard)) {
+        if (getMaterial().insufficient || checkDraw(chessboard[ZOBRISTKEY_IDX])) {
+            if (inCheck1<side ^ 1>()) {
                 return _INFINITE - (mainDepth - depth + 1);
             }
             return -lazyEval<side>() * 2;
@@ -848,26 +857,13 @@ int Search::search(int depth, int alpha, const int beta, _TpvLine *pline, const
     incListId();
     ASSERT_RANGE(KING_BLACK + side, 0, 11);
     ASSERT_RANGE(KING_BLACK + (side ^ 1), 0, 11);
-    const u64 friends = board::getBitmap<side>(chessboard);
-    const u64 enemies = board::getBitmap<side ^ 1>(chessboard);
-    if (generateCaptures<side>(enemies, friends)) {
+    if (inCheck1<side ^ 1>()) {
         decListId();
         score = _INFINITE - (mainDepth - depth + 1);
         return score;
     }
-    generateMoves<side>(friends | enemies);
-    const int listcount = getListSize();
-    if (!listcount) {
-        --listId;
-        if (is_incheck_side) {
-            return -_INFINITE + (mainDepth - depth + 1);
-        } else {
-            return -lazyEval<side>() * 2;
-        }
-    }
-    ASSERT(gen_list[listId].size > 0)
     Hash::_ThashData *c = nullptr;
-    _Tmove *best = &gen_list[listId].moveList[0];
+    _Tmove *best = nullptr;
     if (hashGreaterItem.second.phasheType[Hash::HASH_GREATER].dataS.flags & 0x3) {
         c = &hashGreaterItem.second.phasheType[Hash::HASH_GREATER];
     } else if (hashAlwaysItem.second.phasheType[Hash::HASH_ALWAYS].dataS.flags & 0x3) {
@@ -875,25 +871,22 @@ int Search::search(int depth, int alpha, const int beta, _TpvLine *pline, const
     }
     INC(totGen);
     _Tmove *move;
-    bool checkInCheck = false;
     int countMove = 0;
     char hashf = Hash::hashfALPHA;
-    int first = 0;
-    while ((move = getNextMove(&gen_list[listId], depth, c, first++))) {
+    initMovePicker(c, depth);
+    while ((move = getNextMove<side>())) {
+        if (!best) best = move;
         if (!checkSearchMoves<checkMoves>(move) && depth == mainDepth) continue;
         countMove++;
         INC(betaEfficiencyCount);
-        if (!makemove(move, true, checkInCheck)) {
-            takeback(move, oldKey, true);
-            continue;
-        }
-        checkInCheck = true;
+        makemove(move, true, false);
         if (futilPrune && ((move->s.type & 0x3) != PROMOTION_MOVE_MASK) &&
             futilScore + PIECES_VALUE[move->s.capturedPiece] <= alpha && !board::inCheck1<side>(chessboard)) {
             INC(nCutFp);
             takeback(move, oldKey, true);
             continue;
         }
+        prefetchChild(chessboard[ZOBRISTKEY_IDX] ^ _random::RANDSIDE[side ^ 1], false);
         //Late Move Reduction
         int val = INT_MAX;
         if (countMove > 4 && !is_incheck_side && depth >= 3 && move->s.capturedPiece == SQUARE_EMPTY &&
@@ -937,9 +930,10 @@ int Search::search(int depth, int alpha, const int beta, _TpvLine *pline, const
 
         if (score > alpha) {
             if (score >= beta) {
-                decListId();
                 INC(nCutAB);
-                ADD(betaEfficiency, betaEfficiencyCount / (double) listcount * 100.0);
+                ADD(betaEfficiency, betaEfficiencyCount / (double) max(1, getListSize() + movePicker[listId].nTried) *
+                                    100.0);
+                decListId();
                 if (getRunning()) {
                     Hash::_ThashData data(score, depth - extension, move->s.from, move->s.to, 0, Hash::hashfBETA);
                     hash.recordHash(zobristKeyR, data);
@@ -958,6 +952,14 @@ int Search::search(int depth, int alpha, const int beta, _TpvLine *pline, const
             updatePv(pline, &line, move);
         }
     }
+    if (!movePicker[listId].nMoves) {
+        decListId();
+        if (is_incheck_side) {
+            return -_INFINITE + (mainDepth - depth + 1);
+        } else {
+            return -lazyEval<side>() * 2;
+        }
+    }
     if (getRunning()) {
         Hash::_ThashData data(score, depth - extension, best->s.from, best->s.to, 0, hashf);
         hash.recordHash(zobristKeyR, data);
@@ -136,6 +136,15 @@ private:
     Times *times = &Times::getInstance();
 #endif
 
+    // loads the TT bucket (and the eval cache slot) of the child while its moves are generated
+    inline void prefetchChild(const u64 childKey, const bool withEval) const {
+#ifdef BENCH_MODE
+        if (!hash.getPrefetch()) return;
+#endif
+        hash.prefetch(childKey);
+        if (withEval) prefetchEval(childKey);
+    }
+
     template<bool searchMoves>
     void aspirationWindow(const int depth, const int valWindow);
 
@@ -169,7 +178,9 @@ private:
 
         _TcheckHash checkHashStruct;
         Hash::_ThashData *phashe = &checkHashStruct.phasheType[type];
+        STATS(nHashProbe++)
         if ((phashe->dataU = hash.readHash(type, zobristKeyR))) {
+            STATS(nHashHit++)
             if (phashe->dataS.depth >= depth) {
                 INC(hash.probeHash);
                 if (!currentPly) {
@@ -181,6 +192,7 @@ private:
                         case Hash::hashfEXACT:
                             if (phashe->dataS.score >= beta) {
                                 INC(hash.n_cut_hashB);
+                                STATS(nHashCut++)
                                 return pair<int, _TcheckHash>(beta, checkHashStruct);
                             }
                             break;
@@ -188,12 +200,14 @@ private:
                             if (!quies)incHistoryHeuristic(phashe->dataS.from, phashe->dataS.to, 1);
                             if (phashe->dataS.score >= beta) {
                                 INC(hash.n_cut_hashB);
+                                STATS(nHashCut++)
                                 return pair<int, _TcheckHash>(beta, checkHashStruct);
                             }
                             break;
                         case Hash::hashfALPHA:
                             if (phashe->dataS.score <= alpha) {
                                 INC(hash.n_cut_hashA);
+                                STATS(nHashCut++)
                                 return pair<int, _TcheckHash>(alpha, checkHashStruct);
                             }
                             break;
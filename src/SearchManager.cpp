@@ -362,9 +362,72 @@ void SearchManager::setRepetitionMapCount(int i) {
 
 bool SearchManager::setNthread(int nthread) {
     if (!threadPool->setNthread(nthread))return false;
+    Hash::getInstance().setNthread(nthread);
+    if (evalHashSizeMb != Eval::EVAL_HASH_SIZE_DEFAULT) {
+        setEvalHashSize(evalHashSizeMb);
+    }
+    if (useNNUE) {
+        setUseNNUE(useNNUE);
+    }
+    return true;
+}
+
+bool SearchManager::loadNNUE(const string &fileName) {
+    if (!NNUE::load(fileName)) {
+        return false;
+    }
+    if (nnueActive) {
+        // scores of the previous network
+        clearEvalScores();
+    }
+    setUseNNUE(useNNUE);
     return true;
 }
 
+void SearchManager::setUseNNUE(const bool b) {
+    useNNUE = b;
+    if (b && !NNUE::isLoaded()) {
+        cout << "info string NNUE network not loaded, classic evaluation in use" << endl;
+    }
+    const bool active = b && NNUE::isLoaded();
+    if (active != nnueActive) {
+        // classic and NNUE scores must not be mixed
+        clearEvalScores();
+        nnueActive = active;
+    }
+    for (Search *s:threadPool->getPool()) {
+        s->setUseNNUE(active);
+    }
+}
+
+void SearchManager::clearEvalScores() {
+    for (Search *s:threadPool->getPool()) {
+        s->clearEvalHash();
+    }
+    Hash &hash = Hash::getInstance();
+    if (!hash.isShared()) {
+        hash.clearHash();
+    }
+}
+
+void SearchManager::setEvalHashSize(const int mb) {
+    evalHashSizeMb = mb;
+    for (Search *s:threadPool->getPool()) {
+        s->setEvalHashSize(mb);
+    }
+}
+
+#ifdef BENCH_MODE
+
+void SearchManager::shareEvalHash() {
+    const Search *first = threadPool->getPool()[0];
+    for (Search *s:threadPool->getPool()) {
+        if (s != first) s->shareEvalHash(*first);
+    }
+}
+
+#endif
+
 void SearchManager::stopAllThread() {
     threadPool->getThread(0).setRunningThread(false);
 }
@@ -117,6 +117,31 @@ public:
 
     bool setNthread(int);
 
+    void setEvalHashSize(const int mb);
+
+    int getEvalHashSize() const {
+        return evalHashSizeMb;
+    }
+
+#ifdef BENCH_MODE
+
+    // all the threads use the eval cache of the first one (-bench-eval-cache), setEvalHashSize separates them
+    void shareEvalHash();
+
+#endif
+
+    bool loadNNUE(const string &fileName);
+
+    // the network is used only if it's loaded, otherwise the classic evaluation stays in use
+    void setUseNNUE(const bool b);
+
+    // eval caches and transposition table, after a change of the evaluation
+    void clearEvalScores();
+
+    bool getUseNNUE() const {
+        return threadPool->getPool()[0]->getUseNNUE();
+    }
+
 #if defined(FULL_TEST)
 
     unsigned SZtbProbeWDL() const;
@@ -130,6 +155,10 @@ public:
         return threadPool->getPool()[n]->getChessboard();
     }
 
+    u64 getAttacksBySide(const int side) const {
+        return threadPool->getPool()[0]->getAttacksBySide(side);
+    }
+
     template<int side>
     u64 getPinned(const u64 allpieces, const u64 friends, const int kingPosition) const {
         return board::getPinned<side>(allpieces, friends, kingPosition, threadPool->getPool()[0]->getChessboard());
@@ -137,6 +166,35 @@ public:
 
 #endif
 
+#ifdef STATS_MODE
+
+    void getHashStats(u64 &probe, u64 &hit, u64 &cut) const {
+        probe = hit = cut = 0;
+        for (Search *s:threadPool->getPool()) {
+            probe += s->nHashProbe;
+            hit += s->nHashHit;
+            cut += s->nHashCut;
+        }
+    }
+
+    void getEvalHashStats(u64 &probe, u64 &hit) const {
+        probe = hit = 0;
+        for (Search *s:threadPool->getPool()) {
+            probe += s->nEvalHashProbe;
+            hit += s->nEvalHashHit;
+        }
+    }
+
+    void getPawnHashStats(u64 &probe, u64 &hit) const {
+        probe = hit = 0;
+        for (Search *s:threadPool->getPool()) {
+            probe += s->nPawnHashProbe;
+            hit += s->nPawnHashHit;
+        }
+    }
+
+#endif
+
 #ifdef DEBUG_MODE
 
     unsigned getCumulativeMovesCount() {
@@ -179,6 +237,14 @@ public:
         return i;
     }
 
+    unsigned getNCutSee() {
+        unsigned i = 0;
+        for (Search *s:threadPool->getPool()) {
+            i += s->nCutSee;
+        }
+        return i;
+    }
+
     unsigned getNCutRazor() {
         unsigned i = 0;
         for (Search *s:threadPool->getPool()) {
@@ -205,6 +271,11 @@ private:
 
     ThreadPool<Search> *threadPool = nullptr;
 
+    int evalHashSizeMb = Eval::EVAL_HASH_SIZE_DEFAULT;
+    bool useNNUE = false;
+    // the network is in use
+    bool nnueActive = false;
+
     _TpvLine lineWin;
 
     void setMainPly(const int r);
@@ -73,13 +73,22 @@ void Uci::listner(IterativeDeeping *it) {
             cout << "id name " << NAME << endl;
             cout << "id author Giuseppe Cannella" << endl;
             cout << "option name Hash type spin default 64 min 1 max "
-                 << (0xffffffff / (1024 * 1024 / (sizeof(Hash::_Thash) * 2))) << endl;
+                 << (0xffffffff / (1024 * 1024 / sizeof(Hash::_Tbucket))) << endl;
             cout << "option name Clear Hash type button" << endl;
+            cout << "option name Hash File type string default " << hashFile << endl;
+            cout << "option name Save Hash type button" << endl;
+            cout << "option name Load Hash type button" << endl;
+            cout << "option name Large Pages type check default " << _BOOLEAN[Memory::largePages()] << endl;
+            cout << "option name Shared Hash type string default <empty>" << endl;
+            cout << "option name Shared Hash Unlink type button" << endl;
             cout << "option name Nullmove type check default true" << endl;
             cout << "option name Book File type string default cinnamon.bin" << endl;
             cout << "option name OwnBook type check default " << _BOOLEAN[it->getUseBook()] << "" << endl;
             cout << "option name Ponder type check default " << _BOOLEAN[it->getPonderEnabled()] << "" << endl;
             cout << "option name Threads type spin default 1 min 1 max 64" << endl;
+            cout << "option name Eval Cache type spin default " << Eval::EVAL_HASH_SIZE_DEFAULT << " min 1 max 1024" << endl;
+            cout << "option name EvalFile type string default <empty>" << endl;
+            cout << "option name Use NNUE type check default false" << endl;
             cout << "option name UCI_Chess960 type check default false" << endl;
             cout << "option name GaviotaTbPath type string default <empty>" << endl;
             cout << "option name GaviotaTbCache type spin default 32 min 1 max 1024" << endl;
@@ -107,6 +116,9 @@ void Uci::listner(IterativeDeeping *it) {
         } else if (token.toLower() == "ucinewgame") {
             while (it->getRunning());
             searchManager.loadFen();
+            if (!hash.isShared()) {
+                hash.clearHash();
+            }
             knowCommand = true;
         } else if (token.toLower() == "setvalue") {
             getToken(uip, token);
@@ -190,10 +202,86 @@ void Uci::listner(IterativeDeeping *it) {
                     }
                 } else if (token.toLower() == "hash") {
                     getToken(uip, token);
-                    if (token.toLower() == "value") {
+                    if (token.toLower() == "file") {
+                        getToken(uip, token);
+                        if (token.toLower() == "value") {
+                            getToken(uip, token);
+                            hashFile = token;
+                            knowCommand = true;
+                        }
+                    } else if (token.toLower() == "value") {
                         getToken(uip, token);
+                        while (it->getRunning());
                         hash.setHashSize(stoi(token));
+                        cout << "info string hash size " << hash.getHashSizeMb() << " MB, " << hash.getHashSize()
+                             << " buckets, " << hash.getAllocType() << endl;
+                        knowCommand = true;
+                    }
+                } else if (token.toLower() == "eval") {
+                    getToken(uip, token);
+                    if (token.toLower() == "cache") {
+                        getToken(uip, token);
+                        if (token.toLower() == "value") {
+                            getToken(uip, token);
+                            while (it->getRunning());
+                            searchManager.setEvalHashSize(stoi(token));
+                            knowCommand = true;
+                        }
+                    }
+                } else if (token.toLower() == "evalfile") {
+                    getToken(uip, token);
+                    if (token.toLower() == "value") {
+                        getToken(uip, token);
                         knowCommand = true;
+                        while (it->getRunning());
+                        if (token != "<empty>" && searchManager.loadNNUE(token)) {
+                            cout << "info string NNUE network " << token << " loaded" << endl;
+                        }
+                    }
+                } else if (token.toLower() == "use") {
+                    getToken(uip, token);
+                    if (token.toLower() == "nnue") {
+                        getToken(uip, token);
+                        if (token.toLower() == "value") {
+                            getToken(uip, token);
+                            knowCommand = true;
+                            while (it->getRunning());
+                            searchManager.setUseNNUE(token.toLower() == "true");
+                        }
+                    }
+                } else if (token.toLower() == "large") {
+                    getToken(uip, token);
+                    if (token.toLower() == "pages") {
+                        getToken(uip, token);
+                        if (token.toLower() == "value") {
+                            getToken(uip, token);
+                            while (it->getRunning());
+                            Memory::largePages() = token.toLower() == "true";
+                            hash.setHashSize(hash.getHashSizeMb());
+                            cout << "info string hash size " << hash.getHashSizeMb() << " MB, " << hash.getHashSize()
+                                 << " buckets, " << hash.getAllocType() << endl;
+                            knowCommand = true;
+                        }
+                    }
+                } else if (token.toLower() == "shared") {
+                    getToken(uip, token);
+                    if (token.toLower() == "hash") {
+                        getToken(uip, token);
+                        if (token.toLower() == "value") {
+                            getToken(uip, token);
+                            while (it->getRunning());
+                            hash.setSharedName(token == "<empty>" ? "" : token);
+                            hash.setHashSize(hash.getHashSizeMb());
+                            cout << "info string hash size " << hash.getHashSizeMb() << " MB, " << hash.getHashSize()
+                                 << " buckets, " << hash.getAllocType() << endl;
+                            knowCommand = true;
+                        } else if (token.toLower() == "unlink") {
+                            // the attached processes keep the table, the next one creates a new object
+                            knowCommand = true;
+                            if (!hash.unlinkShared()) {
+                                cout << "info string error - shared memory not removed" << endl;
+                            }
+                        }
                     }
                 } else if (token.toLower() == "nullmove") {
                     getToken(uip, token);
@@ -233,6 +321,25 @@ void Uci::listner(IterativeDeeping *it) {
                         it->enablePonder(token == "true");
                         knowCommand = true;
                     }
+                } else if (token.toLower() == "save") {
+                    getToken(uip, token);
+                    if (token.toLower() == "hash") {
+                        knowCommand = true;
+                        while (it->getRunning());
+                        if (hash.dump(hashFile)) {
+                            cout << "info string hash saved in " << hashFile << endl;
+                        }
+                    }
+                } else if (token.toLower() == "load") {
+                    getToken(uip, token);
+                    if (token.toLower() == "hash") {
+                        knowCommand = true;
+                        while (it->getRunning());
+                        if (hash.load(hashFile)) {
+                            cout << "info string hash loaded from " << hashFile << ", " << hash.getHashSizeMb()
+                                 << " MB" << endl;
+                        }
+                    }
                 } else if (token.toLower() == "clear") {
                     getToken(uip, token);
                     if (token.toLower() == "hash") {
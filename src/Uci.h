@@ -34,6 +34,8 @@ private:
 
     bool uciMode;
 
+    string hashFile = "cinnamon.hsh";
+
     void listner(IterativeDeeping *it);
 
     void getToken(istringstream &uip, String &token);
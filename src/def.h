@@ -33,6 +33,12 @@ typedef struct {
     u64 posKingBit[2];
     int kingSecurity[2];
     uchar posKing[2];
+    // attack maps filled by Eval, valid while attackKey is the zobrist key of the position
+    u64 attackKey;
+    u64 diagAttacks[64];
+    u64 rankFileAttacks[64];
+    u64 attacksByPiece[12];
+    u64 attacksBySide[2];
 } _Tboard;
 
 
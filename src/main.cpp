@@ -43,6 +43,7 @@ using namespace constants;
 
 int main(int argc, char **argv) {
     ASSERT(sizeof(Hash::_Thash) == 16);
+    ASSERT(sizeof(Hash::_Tbucket) == 64);
     ASSERT(sizeof(_Tmove) == 8);
 
 #if defined(FULL_TEST)
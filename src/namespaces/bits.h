@@ -21,6 +21,7 @@
 
 #include "../util/bench/Time.h"
 #include "../util/FileUtil.h"
+#include "../util/Cpu.h"
 #include "debug.h"
 #include "../def.h"
 #include "constants.h"
@@ -48,6 +49,16 @@ namespace _def {
 #define BENCH(a)
 #endif
 
+#if defined(DEBUG_MODE) && !defined(STATS_MODE)
+#define STATS_MODE
+#endif
+
+#ifdef STATS_MODE
+#define STATS(a) (a);
+#else
+#define STATS(a)
+#endif
+
 #ifdef DEBUG_MODE
 #define DEBUG(a) a;
 #define ASSERT(a) _assert(a)
@@ -65,8 +76,13 @@ namespace _def {
 
 #endif
 
+#if defined(DEBUG_MODE) || defined(FULL_TEST)
+#define FULL_ASSERT(a) _assert(a)
+#else
+#define FULL_ASSERT(a)
+#endif
 
-#ifdef HAS_POPCNT
+#if defined(HAS_POPCNT) || defined(__POPCNT__)
 #ifdef HAS_64BIT
 
     static inline int bitCount(const u64 bits) {
@@ -77,6 +93,19 @@ namespace _def {
         return __builtin_popcountl(bits)+__builtin_popcountl(bits>>32);
     }
 #endif
+#elif defined(CPU_DISPATCH)
+
+    static inline int bitCount(u64 bits) {
+        if (CPU_HAS_POPCNT) {
+            u64 count;
+            __asm__("popcntq %1, %0": "=r"(count): "rm"(bits));
+            return (int) count;
+        }
+        int count = 0;
+        for (; bits; RESET_LSB(bits))
+            count++;
+        return count;
+    }
 #else
 
     static inline int bitCount(u64 bits) {
@@ -89,8 +118,9 @@ namespace _def {
 #endif
 
 
-#ifdef HAS_BSF
-#ifdef HAS_64BIT
+// bsf and bsr are in every x86-64 cpu
+#if defined(HAS_BSF) || defined(CPU_DISPATCH)
+#if defined(HAS_64BIT) || defined(CPU_DISPATCH)
 
     static inline int BITScanForward(const u64 bits) {
         size_t idx;
@@ -53,36 +53,6 @@ int board::getDiagShiftCount(const int position, const u64 allpieces) {
     return bitCount(Bitboard::getDiagonalAntiDiagonal(position, allpieces) & ~allpieces);
 }
 
-bool board::checkInsufficientMaterial(const int nPieces, const _Tchessboard &chessboard) {
-    //regexp: KN?B*KB*
-    switch (nPieces) {
-        case 2 :
-            //KK
-            return true;
-        case 3:
-            //KBK
-            if (chessboard[BISHOP_BLACK] || chessboard[BISHOP_WHITE])return true;
-            //KNK
-            if (chessboard[KNIGHT_BLACK] || chessboard[KNIGHT_WHITE])return true;
-            break;
-        case 4 :
-            //KBKB
-            if (chessboard[BISHOP_BLACK] && chessboard[BISHOP_WHITE])return true;
-            //KNKN
-            if (chessboard[KNIGHT_BLACK] && chessboard[KNIGHT_WHITE])return true;
-            //KBKN
-            if (chessboard[BISHOP_BLACK] && chessboard[KNIGHT_WHITE])return true;
-            if (chessboard[BISHOP_WHITE] && chessboard[KNIGHT_BLACK])return true;
-            //KNNK
-            if (bitCount(chessboard[KNIGHT_BLACK]) == 2)return true;
-            if (bitCount(chessboard[KNIGHT_WHITE]) == 2)return true;
-            break;
-        default:
-            return false;
-    }
-    return false;
-}
-
 u64 board::getDiagShiftAndCapture(const int position, const u64 enemies, const u64 allpieces) {
     ASSERT_RANGE(position, 0, 63);
     u64 nuovo = Bitboard::getDiagonalAntiDiagonal(position, allpieces);
@@ -31,12 +31,24 @@ class board {
 public:
     static u64 colors(const int pos);
 
+    // squares attacked by pawns moving in the direction of side
+    template<int side>
+    static u64 getPawnAttacks(const u64 pawns) {
+        if (side == WHITE) {
+            return ((pawns & ~FILE_[0]) << 7) | ((pawns & ~FILE_[7]) << 9);
+        }
+        return ((pawns & ~FILE_[0]) >> 9) | ((pawns & ~FILE_[7]) >> 7);
+    }
+
+    // squares whose color is not covered by bishops
+    static u64 getNoBishopColors(const u64 bishops) {
+        return (bishops & BLACK_SQUARES ? 0 : BLACK_SQUARES) | (bishops & WHITE_SQUARES ? 0 : WHITE_SQUARES);
+    }
+
     static bool isOccupied(const uchar pos, const u64 allpieces);
 
     static int getFile(const char cc);
 
-    static bool checkInsufficientMaterial(const int nPieces, const _Tchessboard &chessboard);
-
     static u64 performRankFileCaptureAndShift(const int position, const u64 enemies, const u64 allpieces);
 
     static int getSide(const _Tchessboard &chessboard);
@@ -119,6 +119,16 @@ namespace constants {
         {VALUEPAWN, VALUEPAWN, VALUEROOK, VALUEROOK, VALUEBISHOP, VALUEBISHOP, VALUEKNIGHT, VALUEKNIGHT, VALUEKING,
          VALUEKING, VALUEQUEEN, VALUEQUEEN, 0};
 
+    // material key: piece counts up to MATERIAL_CAP in mixed radix, black counts then white counts * MATERIAL_SIDE
+    static constexpr int MATERIAL_SIDE = 9 * 3 * 3 * 3 * 2;
+    static constexpr u64 MATERIAL_OVERFLOW = MATERIAL_SIDE * MATERIAL_SIDE;
+
+    static constexpr array<int, 12> MATERIAL_CAP = {8, 8, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1};
+
+    static constexpr array<u64, 12> MATERIAL_WEIGHT =
+        {1, MATERIAL_SIDE, 9, 9 * MATERIAL_SIDE, 27, 27 * MATERIAL_SIDE, 81, 81 * MATERIAL_SIDE, 0, 0, 243,
+         243 * MATERIAL_SIDE};
+
     static constexpr u64 CENTER_MASK = 0x1818000000ULL;
     static constexpr u64 BIG_DIAGONAL = 0x102040810204080ULL;
     static constexpr u64 BIG_ANTIDIAGONAL = 0x8040201008040201ULL;
@@ -0,0 +1,342 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "NNUE.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <vector>
+
+constexpr char NNUE::NNUE_FILE_MAGIC[8];
+short NNUE::ftBias[HIDDEN];
+short NNUE::ftWeights[INPUTS * HIDDEN];
+signed char NNUE::outWeights[2 * HIDDEN];
+int NNUE::outBias;
+int NNUE::netVersion = 0;
+string NNUE::fileName;
+mutex NNUE::mutexLoad;
+
+NNUE::NNUE() {
+    reset();
+}
+
+bool NNUE::load(const string &file) {
+    lock_guard<mutex> lock(mutexLoad);
+    if (!FileUtil::fileExists(file)) {
+        cout << "info string error file " << file << " not found" << endl;
+        return false;
+    }
+    ifstream f(file, ios_base::in | ios_base::binary | ios_base::ate);
+    const u64 fileSize = f.tellg();
+    f.seekg(0);
+    _TnnueHeader header;
+    memset(&header, 0, sizeof(header));
+    f.read((char *) &header, sizeof(header));
+    if (!f || memcmp(header.magic, NNUE_FILE_MAGIC, sizeof(header.magic)) || header.version != NNUE_FILE_VERSION ||
+        header.hidden != HIDDEN ||
+        fileSize != sizeof(header) + sizeof(ftBias) + sizeof(ftWeights) + sizeof(outWeights) + sizeof(outBias)) {
+        cout << "info string error " << file << " is not a compatible network file" << endl;
+        return false;
+    }
+    // the network in use is replaced only by a complete one
+    vector<short> bias(HIDDEN), weights(INPUTS * HIDDEN);
+    vector<signed char> out(2 * HIDDEN);
+    int newOutBias;
+    f.read((char *) bias.data(), sizeof(ftBias));
+    f.read((char *) weights.data(), sizeof(ftWeights));
+    f.read((char *) out.data(), sizeof(outWeights));
+    f.read((char *) &newOutBias, sizeof(outBias));
+    if (!f) {
+        cout << "info string error read file " << file << endl;
+        return false;
+    }
+    memcpy(ftBias, bias.data(), sizeof(ftBias));
+    memcpy(ftWeights, weights.data(), sizeof(ftWeights));
+    memcpy(outWeights, out.data(), sizeof(outWeights));
+    outBias = newOutBias;
+    fileName = file;
+    netVersion++;
+    return true;
+}
+
+void NNUE::reset() {
+    ply = 0;
+    version = netVersion;
+    memset(stack[0].pieces, 0, sizeof(stack[0].pieces));
+    memcpy(stack[0].values[BLACK], ftBias, sizeof(ftBias));
+    memcpy(stack[0].values[WHITE], ftBias, sizeof(ftBias));
+}
+
+void NNUE::refresh(_Taccumulator &acc, const _Tchessboard &chessboard) const {
+    for (int perspective = BLACK; perspective <= WHITE; perspective++) {
+        memcpy(acc.values[perspective], ftBias, sizeof(ftBias));
+        for (int piece = PAWN_BLACK; piece <= QUEEN_WHITE; piece++) {
+            for (u64 x = chessboard[piece]; x; RESET_LSB(x)) {
+                const int square = BITScanForward(x);
+                addWeights(acc.values[perspective], ftWeights + featureIndex(perspective, piece, square) * HIDDEN);
+            }
+        }
+    }
+    memcpy(acc.pieces, chessboard, sizeof(acc.pieces));
+}
+
+void NNUE::update(const _Taccumulator &from, _Taccumulator &to, const _Tchessboard &chessboard) const {
+    int added[MAX_DIRTY], removed[MAX_DIRTY];
+    int nAdded = 0, nRemoved = 0;
+    for (int piece = PAWN_BLACK; piece <= QUEEN_WHITE; piece++) {
+        for (u64 diff = from.pieces[piece] ^ chessboard[piece]; diff; RESET_LSB(diff)) {
+            if (nAdded == MAX_DIRTY || nRemoved == MAX_DIRTY) {
+                // unrelated position (loadFen, clone)
+                refresh(to, chessboard);
+                return;
+            }
+            const int square = BITScanForward(diff);
+            if (chessboard[piece] & POW2[square]) {
+                added[nAdded++] = (piece << 6) | square;
+            } else {
+                removed[nRemoved++] = (piece << 6) | square;
+            }
+        }
+    }
+    if (&from != &to) {
+        memcpy(to.values, from.values, sizeof(to.values));
+    }
+    for (int perspective = BLACK; perspective <= WHITE; perspective++) {
+        for (int i = 0; i < nAdded; i++) {
+            addWeights(to.values[perspective],
+                       ftWeights + featureIndex(perspective, added[i] >> 6, added[i] & 63) * HIDDEN);
+        }
+        for (int i = 0; i < nRemoved; i++) {
+            subWeights(to.values[perspective],
+                       ftWeights + featureIndex(perspective, removed[i] >> 6, removed[i] & 63) * HIDDEN);
+        }
+    }
+    memcpy(to.pieces, chessboard, sizeof(to.pieces));
+}
+
+void NNUE::push(const _Tchessboard &chessboard) {
+    if (version != netVersion) {
+        reset();
+    }
+    if (ply == STACK_SIZE - 1) {
+        update(stack[ply], stack[ply], chessboard);
+        return;
+    }
+    update(stack[ply], stack[ply + 1], chessboard);
+    ply++;
+}
+
+int NNUE::evaluate(const _Tchessboard &chessboard, const int side) {
+    ASSERT_RANGE(side, 0, 1)
+    if (version != netVersion) {
+        reset();
+    }
+    _Taccumulator &acc = stack[ply];
+    if (!samePieces(acc, chessboard)) {
+        update(acc, acc, chessboard);
+    }
+    return propagate(acc.values[side], acc.values[side ^ 1]);
+}
+
+#if defined(__AVX2__)
+#define TARGET_AVX2
+#elif defined(CPU_DISPATCH)
+#define TARGET_AVX2 TARGET("avx2")
+#endif
+
+#if defined(__SSE4_1__)
+#define TARGET_SSE41
+#elif defined(CPU_DISPATCH)
+#define TARGET_SSE41 TARGET("sse4.1")
+#endif
+
+NNUE::_Tkernel NNUE::selectKernel() {
+#if defined(__AVX2__)
+    return KERNEL_AVX2;
+#elif defined(CPU_DISPATCH)
+    if (Cpu::hasAvx2()) return KERNEL_AVX2;
+    if (Cpu::hasSse41()) return KERNEL_SSE41;
+    return KERNEL_SCALAR;
+#elif defined(__SSE4_1__)
+    return KERNEL_SSE41;
+#else
+    return KERNEL_SCALAR;
+#endif
+}
+
+const NNUE::_Tkernel NNUE::kernel = NNUE::selectKernel();
+
+string NNUE::getKernelName() {
+    static const string names[] = {"scalar", "sse4.1", "avx2"};
+    return names[kernel];
+}
+
+static int scaleOutput(const int sum) {
+    constexpr int maxScore = _INFINITE / 4;
+    const int score = (int) ((long long) sum * NNUE::SCALE / (NNUE::QA * NNUE::QB));
+    return max(-maxScore, min(maxScore, score));
+}
+
+#ifdef TARGET_AVX2
+
+TARGET_AVX2 static void addWeightsAvx2(short *acc, const short *w) {
+    for (int i = 0; i < NNUE::HIDDEN; i += 16) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *) (acc + i));
+        _mm256_storeu_si256((__m256i *) (acc + i), _mm256_add_epi16(a, _mm256_loadu_si256((const __m256i *) (w + i))));
+    }
+}
+
+TARGET_AVX2 static void subWeightsAvx2(short *acc, const short *w) {
+    for (int i = 0; i < NNUE::HIDDEN; i += 16) {
+        const __m256i a = _mm256_loadu_si256((const __m256i *) (acc + i));
+        _mm256_storeu_si256((__m256i *) (acc + i), _mm256_sub_epi16(a, _mm256_loadu_si256((const __m256i *) (w + i))));
+    }
+}
+
+TARGET_AVX2 static int propagateAvx2(const short *us, const short *them, const signed char *outWeights,
+                                     const int outBias) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i qa = _mm256_set1_epi16(NNUE::QA);
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = zero;
+    for (int perspective = 0; perspective < 2; perspective++) {
+        const short *acc = perspective ? them : us;
+        const signed char *w = outWeights + perspective * NNUE::HIDDEN;
+        for (int i = 0; i < NNUE::HIDDEN; i += 32) {
+            const __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *) (acc + i)), zero), qa);
+            const __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i *) (acc + i + 16)), zero),
+                                               qa);
+            // packus interleaves the 128 bit lanes
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8);
+            const __m256i product = _mm256_maddubs_epi16(packed, _mm256_loadu_si256((const __m256i *) (w + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(product, ones));
+        }
+    }
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+    return scaleOutput(_mm_cvtsi128_si32(s) + outBias);
+}
+
+#endif
+
+#ifdef TARGET_SSE41
+
+TARGET_SSE41 static void addWeightsSse41(short *acc, const short *w) {
+    for (int i = 0; i < NNUE::HIDDEN; i += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (acc + i));
+        _mm_storeu_si128((__m128i *) (acc + i), _mm_add_epi16(a, _mm_loadu_si128((const __m128i *) (w + i))));
+    }
+}
+
+TARGET_SSE41 static void subWeightsSse41(short *acc, const short *w) {
+    for (int i = 0; i < NNUE::HIDDEN; i += 8) {
+        const __m128i a = _mm_loadu_si128((const __m128i *) (acc + i));
+        _mm_storeu_si128((__m128i *) (acc + i), _mm_sub_epi16(a, _mm_loadu_si128((const __m128i *) (w + i))));
+    }
+}
+
+TARGET_SSE41 static int propagateSse41(const short *us, const short *them, const signed char *outWeights,
+                                       const int outBias) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i qa = _mm_set1_epi16(NNUE::QA);
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = zero;
+    for (int perspective = 0; perspective < 2; perspective++) {
+        const short *acc = perspective ? them : us;
+        const signed char *w = outWeights + perspective * NNUE::HIDDEN;
+        for (int i = 0; i < NNUE::HIDDEN; i += 16) {
+            const __m128i a = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *) (acc + i)), zero), qa);
+            const __m128i b = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i *) (acc + i + 8)), zero), qa);
+            const __m128i product = _mm_maddubs_epi16(_mm_packus_epi16(a, b),
+                                                      _mm_loadu_si128((const __m128i *) (w + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(product, ones));
+        }
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    return scaleOutput(_mm_cvtsi128_si32(sum) + outBias);
+}
+
+#endif
+
+void NNUE::addWeights(short *acc, const short *w) {
+    switch (kernel) {
+#ifdef TARGET_AVX2
+        case KERNEL_AVX2:
+            addWeightsAvx2(acc, w);
+            break;
+#endif
+#ifdef TARGET_SSE41
+        case KERNEL_SSE41:
+            addWeightsSse41(acc, w);
+            break;
+#endif
+        default:
+            for (int i = 0; i < HIDDEN; i++) {
+                acc[i] += w[i];
+            }
+    }
+}
+
+void NNUE::subWeights(short *acc, const short *w) {
+    switch (kernel) {
+#ifdef TARGET_AVX2
+        case KERNEL_AVX2:
+            subWeightsAvx2(acc, w);
+            break;
+#endif
+#ifdef TARGET_SSE41
+        case KERNEL_SSE41:
+            subWeightsSse41(acc, w);
+            break;
+#endif
+        default:
+            for (int i = 0; i < HIDDEN; i++) {
+                acc[i] -= w[i];
+            }
+    }
+}
+
+int NNUE::propagateScalar(const short *us, const short *them) {
+    int sum = outBias;
+    for (int i = 0; i < HIDDEN; i++) {
+        sum += max(0, min(QA, (int) us[i])) * outWeights[i];
+        sum += max(0, min(QA, (int) them[i])) * outWeights[HIDDEN + i];
+    }
+    return scaleOutput(sum);
+}
+
+/**
+ * clipped relu packed to uint8 and multiplied by the int8 weights (maddubs), the pairs can't saturate
+ * because 2 * QA * 128 < 32768; integer sums, the result is identical to propagateScalar
+ */
+int NNUE::propagate(const short *us, const short *them) {
+    switch (kernel) {
+#ifdef TARGET_AVX2
+        case KERNEL_AVX2:
+            return propagateAvx2(us, them, outWeights, outBias);
+#endif
+#ifdef TARGET_SSE41
+        case KERNEL_SSE41:
+            return propagateSse41(us, them, outWeights, outBias);
+#endif
+        default:
+            return propagateScalar(us, them);
+    }
+}
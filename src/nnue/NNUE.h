@@ -0,0 +1,142 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <cstring>
+#include "../namespaces/bits.h"
+#include "../util/Cpu.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__) || defined(CPU_DISPATCH)
+
+#include <immintrin.h>
+
+#endif
+
+using namespace std;
+using namespace _def;
+using namespace constants;
+
+/*
+ * (768 -> HIDDEN) x 2 -> 1 network
+ *
+ * feature transformer: one input for each (piece relative to the perspective, square), int16 weights,
+ * the two accumulators (one for each perspective) are updated incrementally in makemove and takeback.
+ * output layer: clipped relu [0, QA] of the side to move accumulator followed by the other one, int8 weights
+ *
+ * file layout (little endian): _TnnueHeader, short bias[HIDDEN], short weights[INPUTS][HIDDEN],
+ * signed char outWeights[2 * HIDDEN], int outBias
+ */
+class NNUE {
+public:
+    static constexpr int INPUTS = 768;
+    static constexpr int HIDDEN = 256;
+    static constexpr int QA = 127;
+    static constexpr int QB = 64;
+    static constexpr int SCALE = 400;
+    static constexpr unsigned NNUE_FILE_VERSION = 1;
+    static constexpr char NNUE_FILE_MAGIC[8] = {'C', 'I', 'N', 'N', 'N', 'U', 'E', 0};
+
+    typedef struct {
+        char magic[8];
+        unsigned version;
+        unsigned hidden;
+    } _TnnueHeader;
+
+    NNUE();
+
+    // weights are shared by all the threads
+    static bool load(const string &fileName);
+
+    static bool isLoaded() {
+        return netVersion != 0;
+    }
+
+    static const string &getFileName() {
+        return fileName;
+    }
+
+    // after makemove, chessboard is the new position
+    void push(const _Tchessboard &chessboard);
+
+    // after takeback
+    void pop() {
+        if (ply) ply--;
+    }
+
+    // score for the side to move in centipawns
+    int evaluate(const _Tchessboard &chessboard, const int side);
+
+    static int featureIndex(const int perspective, const int piece, const int square) {
+        const int relative = (piece & 1) == perspective ? 0 : 1;
+        return ((relative * 6 + (piece >> 1)) << 6) + (perspective == WHITE ? square : square ^ 56);
+    }
+
+    static void addWeights(short *acc, const short *w);
+
+    static void subWeights(short *acc, const short *w);
+
+    static int propagate(const short *us, const short *them);
+
+    static int propagateScalar(const short *us, const short *them);
+
+    // avx2, sse4.1 or scalar, chosen at build time or at startup with CPU_DISPATCH
+    static string getKernelName();
+
+private:
+    enum _Tkernel {
+        KERNEL_SCALAR = 0, KERNEL_SSE41 = 1, KERNEL_AVX2 = 2
+    };
+
+    static const _Tkernel kernel;
+
+    static _Tkernel selectKernel();
+
+    static constexpr int STACK_SIZE = 256;
+    static constexpr int MAX_DIRTY = 16;
+
+    // values[perspective] is the accumulator of the position in pieces
+    typedef struct {
+        short values[2][HIDDEN];
+        u64 pieces[12];
+    } _Taccumulator;
+
+    _Taccumulator stack[STACK_SIZE];
+    int ply;
+    int version;
+
+    static short ftBias[HIDDEN];
+    static short ftWeights[INPUTS * HIDDEN];
+    static signed char outWeights[2 * HIDDEN];
+    static int outBias;
+    static int netVersion;
+    static string fileName;
+    static mutex mutexLoad;
+
+    void reset();
+
+    void refresh(_Taccumulator &acc, const _Tchessboard &chessboard) const;
+
+    void update(const _Taccumulator &from, _Taccumulator &to, const _Tchessboard &chessboard) const;
+
+    static bool samePieces(const _Taccumulator &acc, const _Tchessboard &chessboard) {
+        return !memcmp(acc.pieces, chessboard, sizeof(acc.pieces));
+    }
+};
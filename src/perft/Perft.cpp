@@ -20,6 +20,7 @@
 
 int Perft::count;
 _ThashPerft **Perft::hash = nullptr;
+vector<Memory::_Tmemory> Perft::hashMemory;
 bool Perft::dumping;
 
 void Perft::dump() {
@@ -106,9 +107,10 @@ Perft::~Perft() {
 
 void Perft::dealloc() const {
     if (hash) {
-        for (int i = 1; i <= perftRes.depth; i++) {
-            free(hash[i]);
+        for (Memory::_Tmemory &m:hashMemory) {
+            Memory::dealloc(m);
         }
+        hashMemory.clear();
         free(hash);
         hash = nullptr;
     }
@@ -119,10 +121,12 @@ void Perft::alloc() {
     hash = (_ThashPerft **) calloc(perftRes.depth + 1, sizeof(_ThashPerft *));
     _assert(hash);
     const u64 k = 1024 * 1024 * mbSize / POW2[perftRes.depth];
+    hashMemory.resize(perftRes.depth + 1);
     for (int i = 1; i <= perftRes.depth; i++) {
         perftRes.sizeAtDepth[i] = k * POW2[i - 1] / sizeof(_ThashPerft);
-        hash[i] = (_ThashPerft *) calloc(perftRes.sizeAtDepth[i], sizeof(_ThashPerft));
-        _assert(hash[i]);
+        const bool b = Memory::alloc(hashMemory[i], perftRes.sizeAtDepth[i] * sizeof(_ThashPerft));
+        _assert(b);
+        hash[i] = (_ThashPerft *) hashMemory[i].ptr;
 
         DEBUG(cout << "alloc hash[" << i << "] " << perftRes.sizeAtDepth[i] * sizeof(_ThashPerft) << endl)
 
@@ -175,6 +179,9 @@ void Perft::run() {
     cout << "depth:\t\t\t" << perftRes.depth << endl;
     cout << "#cpu:\t\t\t" << perftRes.nCpu << endl;
     cout << "cache size:\t\t" << mbSize << endl;
+    if (hash) {
+        cout << "cache memory:\t\t" << Memory::getTypeName(hashMemory[perftRes.depth].type) << endl;
+    }
     cout << "dump file:\t\t" << dumpFile << endl;
     cout << "chess960:\t\t" << chess960 << endl;
     cout << endl << Time::getLocalTime() << " start perft test..." << endl;
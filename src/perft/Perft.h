@@ -34,6 +34,7 @@ class Perft : public Thread<Perft>, public ThreadPool<PerftThread>, public Singl
 
 public:
     static _ThashPerft **hash;
+    static vector<Memory::_Tmemory> hashMemory;
 
     void setParam(const string &fen1,
                   int depth1,
@@ -0,0 +1,100 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(FULL_TEST)
+
+#include <gtest/gtest.h>
+#include <random>
+#include <chrono>
+#include "../util/Bitboard.h"
+
+static vector<pair<int, u64>> randomOccupancies(const int n) {
+    std::mt19937_64 rnd(1);
+    vector<pair<int, u64>> res;
+    for (int i = 0; i < n; i++) {
+        const int pos = (int) (rnd() % 64);
+        // from empty to crowded boards
+        u64 occupancy = rnd();
+        for (int k = i % 4; k; k--) occupancy &= rnd();
+        res.push_back(make_pair(pos, occupancy | POW2[pos]));
+    }
+    return res;
+}
+
+#if defined(USE_BMI2) || defined(__BMI2__)
+static const bool hasPext = true;
+#elif defined(PEXT_BACKEND)
+static const bool hasPext = Cpu::hasBmi2();
+#endif
+
+TEST(bitboard, backends) {
+    Bitboard bitboard;
+#ifdef SLIDER_DISPATCH
+    // the startup choice
+    if (Bitboard::getSlider() == Bitboard::SLIDER_PEXT) {
+        ASSERT_TRUE(hasPext);
+    }
+#endif
+    for (const auto &p:randomOccupancies(200000)) {
+        const u64 rankFile = Bitboard::getRankFileKindergarten(p.first, p.second);
+        const u64 diag = Bitboard::getDiagonalAntiDiagonalKindergarten(p.first, p.second);
+        ASSERT_EQ(rankFile, Bitboard::getRankFileMagic(p.first, p.second));
+        ASSERT_EQ(diag, Bitboard::getDiagonalAntiDiagonalMagic(p.first, p.second));
+#ifdef PEXT_BACKEND
+        if (hasPext) {
+            ASSERT_EQ(rankFile, Bitboard::getRankFilePext(p.first, p.second));
+            ASSERT_EQ(diag, Bitboard::getDiagonalAntiDiagonalPext(p.first, p.second));
+        }
+#endif
+        ASSERT_EQ(rankFile, Bitboard::getRankFile(p.first, p.second));
+        ASSERT_EQ(diag, Bitboard::getDiagonalAntiDiagonal(p.first, p.second));
+    }
+}
+
+// ns for a queen lookup (rank/file and diagonals) with each backend
+TEST(bitboard, bench) {
+    Bitboard bitboard;
+    const auto occupancies = randomOccupancies(4096);
+    constexpr int N = 500;
+    auto bench = [&occupancies](const string &name, u64 (*rankFile)(int, u64), u64 (*diag)(int, u64)) {
+        u64 checksum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < N; n++) {
+            for (const auto &p:occupancies) {
+                // dependent on the previous lookup as in the move generation
+                const u64 occupancy = (p.second ^ (checksum & 1)) | POW2[p.first];
+                checksum += rankFile(p.first, occupancy) ^ diag(p.first, occupancy);
+            }
+        }
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+        cout << "bitboard " << name << ": " << (double) ns / (N * occupancies.size()) << " ns/lookup (checksum "
+             << hex << checksum << dec << ")" << endl;
+        return checksum;
+    };
+    const u64 kindergarten = bench("kindergarten", Bitboard::getRankFileKindergarten,
+                                   Bitboard::getDiagonalAntiDiagonalKindergarten);
+    EXPECT_EQ(kindergarten, bench("magic", Bitboard::getRankFileMagic, Bitboard::getDiagonalAntiDiagonalMagic));
+#ifdef PEXT_BACKEND
+    if (hasPext) {
+        EXPECT_EQ(kindergarten, bench("pext", Bitboard::getRankFilePext, Bitboard::getDiagonalAntiDiagonalPext));
+    }
+#endif
+}
+
+#endif
@@ -19,6 +19,7 @@
 #if defined(FULL_TEST)
 
 #include <gtest/gtest.h>
+#include <random>
 #include "../SearchManager.h"
 
 TEST(eval, eval1) {
@@ -30,4 +31,177 @@ TEST(eval, eval1) {
     EXPECT_EQ(-5, score);
 }
 
+TEST(eval, evalCacheScore) {
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    searchManager.loadFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+    const int score = searchManager.getScore(WHITE, false);
+    searchManager.setEvalHashSize(16);
+    EXPECT_EQ(score, searchManager.getScore(WHITE, false));
+    EXPECT_EQ(score, searchManager.getScore(WHITE, false));
+    searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+}
+
+TEST(eval, pawnHash) {
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    for (const string fen:{"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                           "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                           "6k1/5ppp/8/8/8/8/8/3R2K1 w - - 0 1"}) {
+        searchManager.loadFen(fen);
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        const int score = searchManager.getScore(WHITE, false);
+        // eval cache cleared, pawn hash hit
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        EXPECT_EQ(score, searchManager.getScore(WHITE, false));
+    }
+}
+
+TEST(eval, attackMap) {
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    for (const string fen:{"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                           "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                           "r3n1k1/1p1b1ppp/p2rp3/4B3/q1P2P2/3B4/PP3QPP/R2R2K1 b - - 5 23",
+                           "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"}) {
+        searchManager.loadFen(fen);
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        searchManager.getScore(WHITE, false);
+        const _Tchessboard &chessboard = searchManager.getChessboard(0);
+        const u64 allpieces = searchManager.getBitmap(0, BLACK) | searchManager.getBitmap(0, WHITE);
+        u64 attacks[2] = {0, 0};
+        for (int pos = 0; pos < 64; pos++) {
+            if (board::isAttacked<WHITE>(pos, allpieces, chessboard)) attacks[BLACK] |= POW2[pos];
+            if (board::isAttacked<BLACK>(pos, allpieces, chessboard)) attacks[WHITE] |= POW2[pos];
+        }
+        EXPECT_EQ(attacks[BLACK], searchManager.getAttacksBySide(BLACK));
+        EXPECT_EQ(attacks[WHITE], searchManager.getAttacksBySide(WHITE));
+    }
+}
+
+TEST(eval, tableSum) {
+    std::mt19937_64 rnd(1);
+    for (int i = 0; i < 10000; i++) {
+        u64 bits = rnd();
+        if (i & 1) bits &= rnd() & rnd();
+        for (int side = BLACK; side <= WHITE; side++) {
+            ASSERT_EQ(Eval::tableSumScalar(_eval::BISHOP_OUTPOST[side], bits),
+                      Eval::tableSum(_eval::BISHOP_OUTPOST[side], bits));
+            ASSERT_EQ(Eval::tableSumScalar(_eval::KNIGHT_OUTPOST[side], bits),
+                      Eval::tableSum(_eval::KNIGHT_OUTPOST[side], bits));
+        }
+    }
+    EXPECT_EQ(0, Eval::tableSum(_eval::KNIGHT_OUTPOST[WHITE], 0));
+}
+
+TEST(eval, outposts) {
+    std::mt19937_64 rnd(2);
+    for (int i = 0; i < 1000; i++) {
+        const u64 pawns = rnd() & rnd() & 0x00ffffffffffff00ULL;
+        u64 attacks[2] = {0, 0};
+        for (u64 x = pawns; x; RESET_LSB(x)) {
+            attacks[BLACK] |= PAWN_FORK_MASK[BLACK][BITScanForward(x)];
+            attacks[WHITE] |= PAWN_FORK_MASK[WHITE][BITScanForward(x)];
+        }
+        ASSERT_EQ(attacks[BLACK], board::getPawnAttacks<BLACK>(pawns));
+        ASSERT_EQ(attacks[WHITE], board::getPawnAttacks<WHITE>(pawns));
+    }
+
+    // scores of the per piece implementation, tapered evaluation
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    const std::pair<string, int> positions[] = {
+            {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 50},
+            {"r1bq1rk1/pp3ppp/2n1p3/3pN3/3P4/2PB4/PP3PPP/R2QK2R w KQ - 0 1",        186},
+            {"4k3/pp3p2/4p3/3pN3/3P4/8/PP3PP1/4K3 w - - 0 1",                       388},
+            {"4k3/pp3p2/4p3/3pB3/3P4/8/PP3PP1/4K3 b - - 0 1",                       362},
+            {"2r3k1/1p3ppp/p3p3/2bnN3/3P4/1P2B3/P4PPP/2R3K1 w - - 0 1",             -13},
+            {"r4rk1/1b3ppp/p3p3/1p1nN3/3n4/1B1B4/PP3PPP/R4RK1 b - - 0 1",           -39},
+            {"8/8/3k4/2pNp3/2PbP3/3K4/8/8 w - - 0 1",                               48}};
+    for (const auto &position:positions) {
+        searchManager.loadFen(position.first);
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        EXPECT_EQ(position.second, searchManager.getScore(WHITE, false));
+    }
+}
+
+TEST(eval, taper) {
+    std::mt19937 rnd(4);
+    for (int i = 0; i < 1000; i++) {
+        int mg[4], eg[4], sum = 0, sumMg = 0, sumEg = 0;
+        for (int j = 0; j < 4; j++) {
+            mg[j] = (int) (rnd() % 4001) - 2000;
+            eg[j] = (int) (rnd() % 4001) - 2000;
+            ASSERT_EQ(mg[j], _eval::mgScore(_eval::S(mg[j], eg[j])));
+            ASSERT_EQ(eg[j], _eval::egScore(_eval::S(mg[j], eg[j])));
+            sum += _eval::S(mg[j], eg[j]);
+            sumMg += mg[j];
+            sumEg += eg[j];
+        }
+        // pairs are summed as ints, a plain int is the same in middle and end game
+        ASSERT_EQ(sumMg, _eval::mgScore(sum));
+        ASSERT_EQ(sumEg, _eval::egScore(sum));
+        ASSERT_EQ(mg[0], _eval::S(mg[0], mg[0]));
+    }
+
+    // no jump when a minor piece is exchanged
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    auto score = [&searchManager](const string &fen) {
+        searchManager.loadFen(fen);
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        return searchManager.getScore(WHITE, false);
+    };
+    EXPECT_LT(abs(score("r1bqk2r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 0 1") -
+                  score("r1bqk2r/pppp1ppp/5n2/4p3/2B1P3/5N2/PPPP1PPP/R1BQK2R w KQkq - 0 1")), VALUEPAWN / 2);
+}
+
+TEST(eval, endgames) {
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    auto score = [&searchManager](const string &fen, const int side) {
+        searchManager.loadFen(fen);
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        return searchManager.getScore(side, false);
+    };
+    // KQK KRK: the lone king on the edge is worse
+    EXPECT_GT(score("8/8/8/8/8/8/8/k1K1Q3 w - - 0 1", WHITE), score("8/8/8/3k4/8/8/8/2K1Q3 w - - 0 1", WHITE));
+    EXPECT_GT(score("8/8/8/3k4/8/8/8/2K1Q3 w - - 0 1", WHITE), Eval::KNOWN_WIN);
+    EXPECT_LT(score("8/8/8/3K4/8/8/8/r6k b - - 0 1", WHITE), -Eval::KNOWN_WIN);
+    EXPECT_GT(score("8/8/8/3K4/8/8/8/r6k b - - 0 1", BLACK), Eval::KNOWN_WIN);
+
+    // KBNK: the right corner is the one of the color of the bishop
+    const int corner1 = score("7k/8/5K2/8/8/8/8/BN6 w - - 0 1", WHITE);
+    const int corner2 = score("k7/8/2K5/8/8/8/8/BN6 w - - 0 1", WHITE);
+    EXPECT_GT(corner1, Eval::KNOWN_WIN);
+    // a1 and h8 have the same color
+    EXPECT_GT(corner1, corner2);
+
+    // KQKR won, KRKB KRKN drawish
+    EXPECT_GT(score("8/8/3k4/8/8/2r5/8/2K1Q3 w - - 0 1", WHITE), VALUEQUEEN - VALUEROOK);
+    EXPECT_LT(score("8/8/3k4/8/8/2r5/8/2K1Q3 w - - 0 1", WHITE), Eval::KNOWN_WIN);
+    EXPECT_LT(abs(score("8/8/3k4/8/8/2b5/8/2K1R3 w - - 0 1", WHITE)), VALUEPAWN);
+    EXPECT_LT(abs(score("8/8/3k4/8/8/2n5/8/2K1R3 b - - 0 1", BLACK)), VALUEPAWN);
+}
+
+TEST(eval, material) {
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    // no pawns and a minor piece or two knights: can't win
+    for (const string fen:{"8/8/8/4k3/8/8/8/3KB3 w - - 0 1",
+                           "8/8/8/4k3/8/8/8/2NKN3 w - - 0 1",
+                           "8/8/8/4k3/8/8/8/3KB3 b - - 0 1"}) {
+        searchManager.loadFen(fen);
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        EXPECT_EQ(0, searchManager.getScore(WHITE, false));
+    }
+    // KRKB is scaled down, KQK is not
+    searchManager.loadFen("8/8/8/4k3/8/8/8/3KR1b1 w - - 0 1");
+    searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+    const int krkb = searchManager.getScore(WHITE, false);
+    EXPECT_GT(krkb, 0);
+    EXPECT_LT(krkb, VALUEROOK - VALUEBISHOP);
+    searchManager.loadFen("8/8/8/4k3/8/8/8/3KQ3 w - - 0 1");
+    searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+    EXPECT_GT(searchManager.getScore(WHITE, false), VALUEQUEEN / 2);
+    // three rooks overflow the material key
+    searchManager.loadFen("8/8/8/4k3/8/8/8/1RRKR3 w - - 0 1");
+    searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+    EXPECT_GT(searchManager.getScore(WHITE, false), VALUEROOK * 2);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,230 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(FULL_TEST)
+
+#include <gtest/gtest.h>
+#include <random>
+#include "../IterativeDeeping.h"
+
+TEST(hash, index) {
+    Hash &hash = Hash::getInstance();
+    std::mt19937_64 rnd(1);
+    for (int mb:{1, 3, 64, 100}) {
+        hash.setHashSize(mb);
+        ASSERT_EQ((u64) mb * 1024 * 1024 / sizeof(Hash::_Tbucket), hash.getHashSize());
+        vector<int> count(16);
+        for (int i = 0; i < 100000; i++) {
+            const u64 key = rnd();
+            const unsigned idx = hash.getIndex(key);
+            ASSERT_LT(idx, hash.getHashSize());
+            count[(u64) idx * 16 / hash.getHashSize()]++;
+        }
+        for (int c:count) {
+            EXPECT_NEAR(100000 / 16, c, 400);
+        }
+    }
+    hash.setHashSize(64);
+}
+
+TEST(hash, recordRead) {
+    Hash &hash = Hash::getInstance();
+    hash.setHashSize(1);
+    std::mt19937_64 rnd(2);
+    for (int i = 0; i < 1000; i++) {
+        const u64 key = rnd();
+        Hash::_ThashData data(i, 5, 12, 28, 0, Hash::hashfEXACT);
+        hash.recordHash(key, data);
+        Hash::_ThashData read;
+        read.dataU = hash.readHash(Hash::HASH_ALWAYS, key);
+        EXPECT_EQ(i, read.dataS.score);
+        EXPECT_EQ(28, read.dataS.to);
+        read.dataU = hash.readHash(Hash::HASH_GREATER, key);
+        EXPECT_TRUE(read.dataU == 0 || read.dataS.score == i);
+    }
+    hash.setHashSize(64);
+}
+
+TEST(hash, dumpLoad) {
+    Hash &hash = Hash::getInstance();
+    const string fileName = "cinnamon_test.hsh";
+    hash.setHashSize(2);
+    std::mt19937_64 rnd(4);
+    vector<u64> keys(1000);
+    for (u64 &key:keys) {
+        key = rnd();
+        Hash::_ThashData data(7, 5, 12, 28, 0, Hash::hashfEXACT);
+        hash.recordHash(key, data);
+    }
+    ASSERT_TRUE(hash.dump(fileName));
+    hash.setHashSize(1);
+    ASSERT_TRUE(hash.load(fileName));
+    EXPECT_EQ(2, hash.getHashSizeMb());
+    for (u64 key:keys) {
+        Hash::_ThashData read;
+        read.dataU = hash.readHash(Hash::HASH_ALWAYS, key);
+        EXPECT_EQ(7, read.dataS.score);
+    }
+
+    fstream f(fileName, ios_base::in | ios_base::out | ios_base::binary);
+    f.seekg(sizeof(Hash::_ThashFileHeader) + 100);
+    const char c = f.get();
+    f.seekp(sizeof(Hash::_ThashFileHeader) + 100);
+    f.put(~c);
+    f.close();
+    hash.clearHash();
+    EXPECT_FALSE(hash.load(fileName));
+    EXPECT_EQ(0, hash.readHash(Hash::HASH_ALWAYS, keys[0]));
+    remove(fileName.c_str());
+    hash.setHashSize(64);
+}
+
+TEST(hash, loadChecks) {
+    Hash &hash = Hash::getInstance();
+    const string fileName = "cinnamon_test.hsh";
+    hash.setHashSize(2);
+    ASSERT_TRUE(hash.dump(fileName));
+    hash.setHashSize(1);
+    const u64 key = 0x123456789abcdefULL;
+    Hash::_ThashData data(9, 5, 12, 28, 0, Hash::hashfEXACT);
+    hash.recordHash(key, data);
+
+    Hash::_ThashFileHeader header;
+    fstream f(fileName, ios_base::in | ios_base::out | ios_base::binary);
+    f.read((char *) &header, sizeof(header));
+    // nBuckets * sizeof(_Tbucket) wraps around to the file size
+    header.nBuckets += 1ULL << 58;
+    f.seekp(0);
+    f.write((const char *) &header, sizeof(header));
+    f.close();
+    EXPECT_FALSE(hash.load(fileName));
+    // the table is untouched
+    EXPECT_EQ(1, hash.getHashSizeMb());
+    Hash::_ThashData read;
+    read.dataU = hash.readHash(Hash::HASH_ALWAYS, key);
+    EXPECT_EQ(9, read.dataS.score);
+    remove(fileName.c_str());
+    hash.setHashSize(64);
+}
+
+TEST(hash, resize) {
+    Hash &hash = Hash::getInstance();
+    hash.setNthread(3);
+    hash.setHashSize(2);
+    std::mt19937_64 rnd(5);
+    vector<u64> keys(2000);
+    for (unsigned i = 0; i < keys.size(); i++) {
+        keys[i] = rnd();
+        Hash::_ThashData data(i, i % 64, 12, 28, 0, Hash::hashfEXACT);
+        hash.recordHash(keys[i], data);
+    }
+    for (int mb:{8, 1, 3}) {
+        hash.setHashSize(mb);
+        for (unsigned i = 0; i < keys.size(); i++) {
+            Hash::_ThashData read;
+            read.dataU = hash.readHash(Hash::HASH_ALWAYS, keys[i]);
+            if (!read.dataU) {
+                read.dataU = hash.readHash(Hash::HASH_GREATER, keys[i]);
+            }
+            EXPECT_EQ((int) i, read.dataS.score);
+        }
+    }
+    hash.setNthread(1);
+    hash.setHashSize(64);
+}
+
+#ifdef HAS_MMAP
+
+TEST(hash, shared) {
+    const string name = "cinnamon_test_" + to_string(getpid());
+    Memory::_Tmemory a, b, c;
+    bool created;
+    ASSERT_TRUE(Memory::allocShared(a, name, 1 << 20, created));
+    EXPECT_TRUE(created);
+    Memory::publishShared(a);
+    // the size of the existing object
+    ASSERT_TRUE(Memory::allocShared(b, name, 4 << 20, created));
+    EXPECT_FALSE(created);
+    EXPECT_EQ(a.size, b.size);
+    ((char *) a.ptr)[100] = 7;
+    EXPECT_EQ(7, ((char *) b.ptr)[100]);
+    Memory::dealloc(a);
+    ASSERT_TRUE(Memory::allocShared(c, name, 1 << 20, created));
+    EXPECT_FALSE(created);
+    Memory::dealloc(c);
+    // the last process detached removes the name
+    Memory::dealloc(b);
+    ASSERT_TRUE(Memory::allocShared(c, name, 1 << 20, created));
+    EXPECT_TRUE(created);
+    Memory::publishShared(c);
+
+    // the generation is in the first bucket of the shared table
+    Hash &hash = Hash::getInstance();
+    const string hashName = name + "_hash";
+    hash.setSharedName(hashName);
+    hash.setHashSize(1);
+    ASSERT_TRUE(hash.isShared());
+    EXPECT_FALSE(hash.load("cinnamon_test.hsh"));
+    ASSERT_TRUE(Memory::allocShared(a, hashName, 1 << 20, created));
+    EXPECT_FALSE(created);
+    EXPECT_EQ((u64) 1 << 20, a.size - sizeof(Hash::_Tbucket));
+    const uchar generation = *(uchar *) a.ptr;
+    hash.newGeneration();
+    EXPECT_EQ((uchar) (generation + 1), *(uchar *) a.ptr);
+    Memory::dealloc(a);
+    hash.setSharedName("");
+    hash.setHashSize(64);
+    EXPECT_FALSE(hash.isShared());
+    ASSERT_TRUE(Memory::allocShared(a, hashName, 1 << 20, created));
+    EXPECT_TRUE(created);
+    Memory::dealloc(a);
+
+    // name removed with processes attached
+    EXPECT_TRUE(Memory::unlinkShared(name));
+    EXPECT_FALSE(Memory::unlinkShared(name));
+    Memory::dealloc(c);
+}
+
+TEST(hash, sharedDetachRace) {
+    const string name = "cinnamon_test_race_" + to_string(getpid());
+    Memory::_Tmemory a, b;
+    bool created;
+    ASSERT_TRUE(Memory::allocShared(a, name, 1 << 20, created));
+    Memory::publishShared(a);
+    ((char *) a.ptr)[100] = 7;
+    // the last process counted down and has not removed the name yet
+    ((Memory::_TsharedHeader *) a.raw)->attached.store(0);
+    std::thread unlinker([&name]() {
+        this_thread::sleep_for(chrono::milliseconds(20));
+        Memory::unlinkShared(name);
+    });
+    ASSERT_TRUE(Memory::allocShared(b, name, 1 << 20, created));
+    unlinker.join();
+    // a new object, not the one removed
+    EXPECT_TRUE(created);
+    EXPECT_EQ(0, ((char *) b.ptr)[100]);
+    EXPECT_EQ(1, ((Memory::_TsharedHeader *) b.raw)->attached.load());
+    a.name.clear();
+    Memory::dealloc(a);
+    Memory::dealloc(b);
+    EXPECT_FALSE(Memory::unlinkShared(name));
+}
+
+#endif
+
+#endif
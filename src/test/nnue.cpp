@@ -0,0 +1,147 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#if defined(FULL_TEST)
+
+#include <gtest/gtest.h>
+#include <random>
+#include <memory>
+#include "../IterativeDeeping.h"
+#include "../nnue/NNUE.h"
+
+// random network in the NNUE file format
+static void writeRandomNetwork(const string &fileName, const unsigned seed) {
+    std::mt19937 rnd(seed);
+    ofstream f(fileName, ios_base::out | ios_base::binary);
+    NNUE::_TnnueHeader header;
+    memcpy(header.magic, NNUE::NNUE_FILE_MAGIC, sizeof(header.magic));
+    header.version = NNUE::NNUE_FILE_VERSION;
+    header.hidden = NNUE::HIDDEN;
+    f.write((const char *) &header, sizeof(header));
+    for (int i = 0; i < NNUE::HIDDEN; i++) {
+        const short b = (short) ((int) (rnd() % 101) - 20);
+        f.write((const char *) &b, sizeof(b));
+    }
+    for (int i = 0; i < NNUE::INPUTS * NNUE::HIDDEN; i++) {
+        const short w = (short) ((int) (rnd() % 41) - 20);
+        f.write((const char *) &w, sizeof(w));
+    }
+    for (int i = 0; i < 2 * NNUE::HIDDEN; i++) {
+        const signed char w = (signed char) ((int) (rnd() % 256) - 128);
+        f.write((const char *) &w, sizeof(w));
+    }
+    const int outBias = (int) (rnd() % 1000);
+    f.write((const char *) &outBias, sizeof(outBias));
+}
+
+TEST(nnue, kernel) {
+    const string fileName = "cinnamon_test.nnue";
+    writeRandomNetwork(fileName, 1);
+    ASSERT_TRUE(NNUE::load(fileName));
+    remove(fileName.c_str());
+
+    std::mt19937 rnd(2);
+    short us[NNUE::HIDDEN], them[NNUE::HIDDEN], w[NNUE::HIDDEN], expected[NNUE::HIDDEN];
+    for (int n = 0; n < 1000; n++) {
+        for (int i = 0; i < NNUE::HIDDEN; i++) {
+            us[i] = (short) ((int) (rnd() % 400) - 200);
+            them[i] = (short) ((int) (rnd() % 400) - 200);
+            w[i] = (short) ((int) (rnd() % 200) - 100);
+        }
+        ASSERT_EQ(NNUE::propagateScalar(us, them), NNUE::propagate(us, them));
+
+        for (int i = 0; i < NNUE::HIDDEN; i++) expected[i] = (short) (us[i] + w[i]);
+        NNUE::addWeights(us, w);
+        ASSERT_EQ(0, memcmp(expected, us, sizeof(us)));
+        for (int i = 0; i < NNUE::HIDDEN; i++) expected[i] = (short) (us[i] - w[i]);
+        NNUE::subWeights(us, w);
+        ASSERT_EQ(0, memcmp(expected, us, sizeof(us)));
+    }
+}
+
+TEST(nnue, switchBackend) {
+    const string fileName = "cinnamon_test.nnue";
+    writeRandomNetwork(fileName, 5);
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    searchManager.setUseNNUE(false);
+    ASSERT_TRUE(searchManager.loadNNUE(fileName));
+    IterativeDeeping it;
+    it.loadFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    const int classic = searchManager.getScore(WHITE, false);
+    std::unique_ptr<NNUE> fresh(new NNUE());
+    const int nnue = fresh->evaluate(searchManager.getChessboard(0), WHITE);
+    ASSERT_NE(classic, nnue);
+
+    // no stale score in the eval cache
+    searchManager.setUseNNUE(true);
+    EXPECT_EQ(nnue, searchManager.getScore(WHITE, false));
+    writeRandomNetwork(fileName, 6);
+    ASSERT_TRUE(searchManager.loadNNUE(fileName));
+    remove(fileName.c_str());
+    fresh.reset(new NNUE());
+    EXPECT_EQ(fresh->evaluate(searchManager.getChessboard(0), WHITE), searchManager.getScore(WHITE, false));
+    searchManager.setUseNNUE(false);
+    EXPECT_EQ(classic, searchManager.getScore(WHITE, false));
+}
+
+TEST(nnue, load) {
+    const string fileName = "cinnamon_test.nnue";
+    {
+        ofstream f(fileName, ios_base::out | ios_base::binary);
+        f << "not a network";
+    }
+    EXPECT_FALSE(NNUE::load(fileName));
+    remove(fileName.c_str());
+    EXPECT_FALSE(NNUE::load(fileName));
+}
+
+TEST(nnue, incremental) {
+    const string fileName = "cinnamon_test.nnue";
+    writeRandomNetwork(fileName, 3);
+    SearchManager &searchManager = Singleton<SearchManager>::getInstance();
+    ASSERT_TRUE(searchManager.loadNNUE(fileName));
+    remove(fileName.c_str());
+    searchManager.setUseNNUE(true);
+    ASSERT_TRUE(searchManager.getUseNNUE());
+
+    std::unique_ptr<NNUE> fresh(new NNUE());
+    IterativeDeeping it;
+    it.loadFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    for (const string move:{"e1g1", "h3g2", "d5e6", "g2f1q", "e6f7", "e8d8", "f7f8n"}) {
+        _Tmove m;
+        searchManager.getMoveFromSan(move, &m);
+        searchManager.makemove(&m);
+        const int side = board::getSide(searchManager.getChessboard(0));
+        searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+        EXPECT_EQ(fresh->evaluate(searchManager.getChessboard(0), side), searchManager.getScore(side, false));
+    }
+
+    it.loadFen("r3n1k1/1p1b1ppp/p2rp3/4B3/q1P2P2/3B4/PP3QPP/R2R2K1 b - - 5 23");
+    searchManager.setMaxTimeMillsec(1000);
+    it.setMaxDepth(5);
+    it.start();
+    it.join();
+    // back at the root after the search
+    searchManager.setEvalHashSize(Eval::EVAL_HASH_SIZE_DEFAULT);
+    EXPECT_EQ(fresh->evaluate(searchManager.getChessboard(0), BLACK), searchManager.getScore(BLACK, false));
+
+    searchManager.setUseNNUE(false);
+    EXPECT_FALSE(searchManager.getUseNNUE());
+}
+
+#endif
@@ -19,9 +19,120 @@
 #if defined(FULL_TEST)
 
 #include <gtest/gtest.h>
+#include <memory>
 #include "../IterativeDeeping.h"
 #include "../def.h"
 
+// exposes the move picker of a node
+class MovePickerTest : public Eval {
+public:
+    static string moveKey(const _Tmove &m) {
+        if (m.s.type & 0xc) return "castle" + to_string(m.s.type & 0xc);
+        return to_string(m.s.from) + "-" + to_string(m.s.to) + "=" + to_string((int) m.s.promotionPiece);
+    }
+
+    static string moveKey(const int from, const int to) {
+        return to_string(from) + "-" + to_string(to) + "=" + to_string(NO_PROMOTION);
+    }
+
+    template<int side>
+    vector<string> generate() {
+        vector<string> res;
+        incListId();
+        generateCaptures<side>(board::getBitmap<side ^ 1>(chessboard), board::getBitmap<side>(chessboard));
+        generateMoves<side>(board::getBitmap<side>(chessboard) | board::getBitmap<side ^ 1>(chessboard));
+        for (int i = 0; i < getListSize(); i++) res.push_back(moveKey(gen_list[listId].moveList[i]));
+        decListId();
+        return res;
+    }
+
+    template<int side>
+    vector<string> pick(const int from, const int to) {
+        vector<string> res;
+        const Hash::_ThashData hashData(0, 1, (uchar) from, (uchar) to, 0, Hash::hashfEXACT);
+        incListId();
+        initMovePicker(&hashData, 1);
+        _Tmove *move;
+        while ((move = getNextMove<side>())) res.push_back(moveKey(*move));
+        decListId();
+        return res;
+    }
+
+    u64 getKey() const {
+        return chessboard[ZOBRISTKEY_IDX];
+    }
+
+    // see of a capture in coordinate notation
+    template<int side>
+    int seeOf(const string &move) {
+        int res = INT_MAX;
+        incListId();
+        generateCaptures<side>(board::getBitmap<side ^ 1>(chessboard), board::getBitmap<side>(chessboard));
+        for (int i = 0; i < getListSize(); i++) {
+            const _Tmove &m = gen_list[listId].moveList[i];
+            if (BOARD[m.s.from] + BOARD[m.s.to] == move) res = see<side>(m);
+        }
+        decListId();
+        return res;
+    }
+
+    void killers(const vector<pair<int, int>> &moves) {
+        clearHeuristic();
+        for (const auto &m:moves) setKiller(m.first, m.second, 1, false);
+        setKiller(moves[0].second, moves[0].first, 1, true);
+    }
+};
+
+TEST(search, see) {
+    std::unique_ptr<MovePickerTest> picker(new MovePickerTest());
+    const vector<tuple<string, string, int>> captures = {
+            // undefended pawn
+            make_tuple("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", VALUEPAWN),
+            // the queens behind the rook and the bishop
+            make_tuple("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", VALUEPAWN - VALUEKNIGHT),
+            // the second rook recaptures through the first one
+            make_tuple("4k3/4r3/8/4p3/8/8/4R3/4R1K1 w - - 0 1", "e2e5", VALUEPAWN),
+            make_tuple("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", VALUEPAWN),
+            make_tuple("4k3/8/3p4/4p3/8/8/8/4QK2 w - - 0 1", "e1e5", VALUEPAWN - VALUEQUEEN),
+            make_tuple("2r1k3/8/8/8/8/8/2P5/3K4 b - - 0 1", "c8c2", VALUEPAWN - VALUEROOK)};
+    for (const auto &capture:captures) {
+        const int side = picker->loadFen(get<0>(capture));
+        const int res = side ? picker->seeOf<WHITE>(get<1>(capture)) : picker->seeOf<BLACK>(get<1>(capture));
+        EXPECT_EQ(get<2>(capture), res) << get<0>(capture) << " " << get<1>(capture);
+    }
+}
+
+TEST(search, movePicker) {
+    std::unique_ptr<MovePickerTest> picker(new MovePickerTest());
+    const vector<string> fens = {
+            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+            "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+            "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+            "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+            "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1"};
+    for (const string &fen:fens) {
+        const int side = picker->loadFen(fen);
+        const vector<string> all = side ? picker->generate<WHITE>() : picker->generate<BLACK>();
+        const u64 key = picker->getKey();
+        const set<string> expected(all.begin(), all.end());
+        // every square pair as hash move and killer, most are not pseudo legal
+        for (int from = 0; from < 64; from++) {
+            for (int to = 0; to < 64; to++) {
+                picker->killers({{to, from}, {from, to}, {(from + 9) & 63, to}});
+                picker->loadFen(fen);
+                const vector<string> res = side ? picker->pick<WHITE>(from, to) : picker->pick<BLACK>(from, to);
+                ASSERT_EQ(key, picker->getKey());
+                ASSERT_EQ(all.size(), res.size()) << fen << " " << from << " " << to;
+                ASSERT_EQ(expected, set<string>(res.begin(), res.end())) << fen << " " << from << " " << to;
+                if (expected.count(MovePickerTest::moveKey(from, to))) {
+                    ASSERT_EQ(MovePickerTest::moveKey(from, to), res[0]);
+                }
+            }
+        }
+    }
+}
+
 
 TEST(search, test0) {
     IterativeDeeping it;
@@ -30,7 +141,9 @@ TEST(search, test0) {
     searchManager.setMaxTimeMillsec(250);
     it.start();
     it.join();
-    EXPECT_EQ("e3g5", it.getBestmove());
+    // both mate
+    const set<string> v = {"e3g5", "f6g5"};
+    EXPECT_TRUE(v.end() != v.find(it.getBestmove()));
 }
 
 TEST(search, test1) {
@@ -19,10 +19,13 @@
 #if defined(FULL_TEST)
 
 #include "pin.cpp"
+#include "bitboard.cpp"
 #include "eval.cpp"
 //#include "spinlockShared.cpp"
 //#include "spinlock.cpp"
 #include "search.cpp"
+#include "hash.cpp"
+#include "nnue.cpp"
 #include "perft.cpp"
 #include "perft960.cpp"
 #include "syzygy.cpp"
@@ -22,6 +22,15 @@ u64 Bitboard::BITBOARD_DIAGONAL[64][256];
 u64 Bitboard::BITBOARD_ANTIDIAGONAL[64][256];
 u64 Bitboard::BITBOARD_FILE[64][256];
 u64 Bitboard::BITBOARD_RANK[64][256];
+Bitboard::_Tmagic Bitboard::ROOK_MAGIC[64];
+Bitboard::_Tmagic Bitboard::BISHOP_MAGIC[64];
+u64 Bitboard::ROOK_ATTACKS[ROOK_TABLE_SIZE];
+u64 Bitboard::BISHOP_ATTACKS[BISHOP_TABLE_SIZE];
+#ifdef PEXT_BACKEND
+u64 Bitboard::ROOK_PEXT[ROOK_TABLE_SIZE];
+u64 Bitboard::BISHOP_PEXT[BISHOP_TABLE_SIZE];
+#endif
+Bitboard::_Tslider Bitboard::slider = SLIDER_KINDERGARTEN;
 volatile bool Bitboard::generated = false;
 mutex Bitboard::mutexConstructor;
 
@@ -77,11 +86,106 @@ Bitboard::Bitboard() {
     popolateDiagonal();
     popolateColumn();
     popolateRank();
+#ifdef PEXT_BACKEND
+    popolateMagic(ROOK_MAGIC, ROOK_ATTACKS, ROOK_PEXT, true);
+    popolateMagic(BISHOP_MAGIC, BISHOP_ATTACKS, BISHOP_PEXT, false);
+#else
+    popolateMagic(ROOK_MAGIC, ROOK_ATTACKS, nullptr, true);
+    popolateMagic(BISHOP_MAGIC, BISHOP_ATTACKS, nullptr, false);
+#endif
+#if defined(SLIDER_DISPATCH)
+    slider = Cpu::hasBmi2() && !Cpu::isSlowPext() ? SLIDER_PEXT : SLIDER_MAGIC;
+#elif defined(USE_KINDERGARTEN)
+    slider = SLIDER_KINDERGARTEN;
+#elif defined(USE_MAGIC)
+    slider = SLIDER_MAGIC;
+#else
+    slider = SLIDER_PEXT;
+#endif
     free(tmpStruct);
     tmpStruct = nullptr;
     generated = true;
 }
 
+// fancy magics for the square mapping of the engine, from a random search (sparse candidates, fixed seed)
+static constexpr u64 ROOK_MAGICS[64] = {
+        0x1080004008801020ULL, 0x840092002c03000ULL, 0x1900200010400900ULL, 0x880100008000480ULL,
+        0x4200100420080200ULL, 0x8100020100080400ULL, 0x200040110886200ULL, 0x200008040220411ULL,
+        0x404800084400220ULL, 0x401000402000ULL, 0x86001081220440ULL, 0x408800800100280ULL,
+        0xa001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x442000102105084ULL,
+        0x9080010020804100ULL, 0x40404000201009ULL, 0x808010002009ULL, 0x2200090021d00100ULL,
+        0x8008008040080ULL, 0x4004002010040ULL, 0x11040008015042ULL, 0xa0001768104ULL,
+        0x800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+        0x442000a00049020ULL, 0x2100040080020080ULL, 0x800120400900148ULL, 0x10040a00128541ULL,
+        0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x610008410800800ULL,
+        0x400802402800800ULL, 0xc100020080800400ULL, 0x2000802000401ULL, 0x182085882000401ULL,
+        0x220204000808000ULL, 0x2860100040024022ULL, 0x1002004110040ULL, 0x99101042000a0020ULL,
+        0x4080004008080ULL, 0x10040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+        0x88403882010200ULL, 0x820400080210100ULL, 0x110910040a00300ULL, 0x801100280080480ULL,
+        0x242009008200600ULL, 0x1002000489500200ULL, 0x40800200010080ULL, 0x91800041000080ULL,
+        0x209300488001ULL, 0x4c1002414824001ULL, 0x20020000b001041ULL, 0x7000100004200901ULL,
+        0x8002002004100802ULL, 0x30010002084c0007ULL, 0x888221800813004ULL, 0x4000002840840112ULL
+};
+
+static constexpr u64 BISHOP_MAGICS[64] = {
+        0x2048017020910100ULL, 0x44410424008008ULL, 0x40828a400900000ULL, 0x8002209200022000ULL,
+        0x2021000540002ULL, 0x21018840000000ULL, 0x9e8420204002ULL, 0xa0920110084480ULL,
+        0x4003062018010110ULL, 0x221046812004e09ULL, 0x1e11002958912a0ULL, 0x44410804000ULL,
+        0x821210000080ULL, 0x80201102210a800ULL, 0x80040411045004ULL, 0x704a1842021000ULL,
+        0x1005061070322800ULL, 0x18001010410444ULL, 0x10000800401420ULL, 0x2204002844000800ULL,
+        0x2052020412022280ULL, 0xa020101008208ULL, 0x40400201042000ULL, 0x3e1082040480410ULL,
+        0x1004200004208414ULL, 0x8700400984808c8ULL, 0x88080004004410ULL, 0x8c0240140100a2ULL,
+        0x8840001822000ULL, 0x50088001080100ULL, 0x98140840040a2200ULL, 0x3002020900210110ULL,
+        0x1004040640206000ULL, 0x1090909000840400ULL, 0x9002444810100020ULL, 0x4000020080080080ULL,
+        0x28020400011010ULL, 0x290808300020100ULL, 0x8010020882004410ULL, 0x604010040082c20ULL,
+        0x20040104c0801008ULL, 0x6004208424001050ULL, 0x1002840041000800ULL, 0x200042018000102ULL,
+        0xa8002000a0821c00ULL, 0x40080802201910ULL, 0x222620444000100ULL, 0x2080041020088ULL,
+        0x1500820110401050ULL, 0x492090100080ULL, 0x900410041100000ULL, 0x302000420880000ULL,
+        0x10501202020020ULL, 0x8200490049040ULL, 0x462080214a40120ULL, 0x2421310102008100ULL,
+        0x2400420080884060ULL, 0x800804406184208ULL, 0xb0080124a084400ULL, 0x82e082300840412ULL,
+        0x6051049040082200ULL, 0xc610211002102101ULL, 0x48808010433ULL, 0x10200804405440ULL
+};
+
+// the attacks come from the kindergarten tables
+void Bitboard::popolateMagic(_Tmagic *magics, u64 *attacks, u64 *pextAttacks, const bool rook) {
+    constexpr u64 EDGE_RANKS = 0xff000000000000ffULL;
+    constexpr u64 EDGE_FILES = 0x8181818181818181ULL;
+    u64 *table = attacks;
+    u64 *pextTable = pextAttacks;
+    for (int pos = 0; pos < 64; pos++) {
+        _Tmagic &m = magics[pos];
+        if (rook) {
+            m.mask = ((RANK[pos] & ~EDGE_FILES) | (FILE_[pos] & ~EDGE_RANKS)) & NOTPOW2[pos];
+            m.magic = ROOK_MAGICS[pos];
+        } else {
+            m.mask = (DIAGONAL[pos] | ANTIDIAGONAL[pos]) & ~(EDGE_FILES | EDGE_RANKS) & NOTPOW2[pos];
+            m.magic = BISHOP_MAGICS[pos];
+        }
+        const int bits = bitCount(m.mask);
+        m.shift = 64 - bits;
+        m.attacks = table;
+        m.pextAttacks = pextTable;
+        u64 sub = 0;
+        // the carry-rippler enumerates the subsets in pext order
+        unsigned pextIdx = 0;
+        do {
+            const u64 a = rook ? getRankFileKindergarten(pos, sub | POW2[pos])
+                               : getDiagonalAntiDiagonalKindergarten(pos, sub | POW2[pos]);
+            const unsigned idx = (unsigned) ((sub * m.magic) >> m.shift);
+            // constructive collisions only
+            ASSERT(!table[idx] || table[idx] == a);
+            table[idx] = a;
+#ifdef PEXT_BACKEND
+            pextTable[pextIdx++] = a;
+#endif
+            sub = (sub - m.mask) & m.mask;
+        } while (sub);
+        table += 1 << bits;
+        if (pextTable) pextTable += 1 << bits;
+    }
+    ASSERT(table - attacks == (rook ? ROOK_TABLE_SIZE : BISHOP_TABLE_SIZE));
+}
+
 void Bitboard::popolateDiagonal() {
     vector<u64> combinationsDiagonal;
     for (uchar pos = 0; pos < 64; pos++) {
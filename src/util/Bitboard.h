@@ -23,10 +23,26 @@
 #include "../namespaces/constants.h"
 #include "logger.h"
 #include "bench/Times.h"
+#include "Cpu.h"
 #include <mutex>
 #include <iostream>
 
-#ifdef USE_BMI2
+// SLIDER=kindergarten|magic|pext fixes the backend, otherwise it is pext when the -m flags have bmi2 and it is
+// chosen at startup in the other x86-64 builds
+#if defined(USE_PEXT) && !defined(USE_BMI2) && !defined(__BMI2__)
+#error "SLIDER=pext needs BMI2"
+#endif
+
+#if !defined(USE_KINDERGARTEN) && !defined(USE_MAGIC) && !defined(USE_BMI2) && !defined(__BMI2__)
+#ifdef CPU_DISPATCH
+#define SLIDER_DISPATCH
+#else
+#define USE_KINDERGARTEN
+#endif
+#endif
+
+#if defined(USE_BMI2) || defined(__BMI2__) || defined(CPU_DISPATCH)
+#define PEXT_BACKEND
 
 #include <immintrin.h>
 
@@ -36,13 +52,36 @@ using namespace _def;
 using namespace constants;
 using std::vector;
 
-//Kindergarten
+/**
+ * sliding attacks, three backends:
+ * - kindergarten: two [64][256] lookups for each slider, the line index by multiply or by
+ *   _pext_u64 with USE_BMI2
+ * - fancy magic (USE_MAGIC): one lookup in a table shared by all the squares
+ * - full occupancy pext (USE_PEXT or the default with USE_BMI2): one lookup, the index is _pext_u64 of the relevant
+ *   occupancy; slow on AMD before Zen 3 where pext is microcoded
+ * fixed at build time (USE_KINDERGARTEN, USE_MAGIC, pext with bmi2) the lookup is inlined; x86-64 builds without
+ * bmi2 choose pext or magic at startup (SLIDER_DISPATCH) and branch on each lookup, the other builds use
+ * kindergarten. All the tables are built, the backends can be compared on the same host (test/bitboard.cpp)
+ */
 class Bitboard {
 
 public:
 
+    enum _Tslider {
+        SLIDER_KINDERGARTEN = 0, SLIDER_MAGIC = 1, SLIDER_PEXT = 2
+    };
+
     Bitboard();
 
+    static _Tslider getSlider() {
+        return slider;
+    }
+
+    static string getSliderName() {
+        static const string names[] = {"kindergarten", "magic", "pext"};
+        return names[slider];
+    }
+
     static inline u64 getRankFile(const int position, const u64 allpieces) {
 //    ........            00000000
 //    ...q....            00010000
@@ -53,8 +92,15 @@ public:
 //    ...Q....            00010000
 //    ........            00000000
 
-        return (BITBOARD_FILE[position][fileIdx(position, allpieces)]) |
-               BITBOARD_RANK[position][rankIdx(position, allpieces)];
+#if defined(SLIDER_DISPATCH)
+        return slider == SLIDER_PEXT ? getRankFilePext(position, allpieces) : getRankFileMagic(position, allpieces);
+#elif defined(USE_KINDERGARTEN)
+        return getRankFileKindergarten(position, allpieces);
+#elif defined(USE_MAGIC)
+        return getRankFileMagic(position, allpieces);
+#else
+        return getRankFilePext(position, allpieces);
+#endif
     }
 
     static inline u64 getDiagonalAntiDiagonal(const int position, const u64 allpieces) {
@@ -68,14 +114,88 @@ public:
 //    ........            00000100
 //    ........            00000010
 
-        auto a = BITBOARD_DIAGONAL[position][diagonalIdx(position, allpieces)] |
-                 BITBOARD_ANTIDIAGONAL[position][antiDiagonalIdx(position, allpieces)];
+#if defined(SLIDER_DISPATCH)
+        auto a = slider == SLIDER_PEXT ? getDiagonalAntiDiagonalPext(position, allpieces)
+                                       : getDiagonalAntiDiagonalMagic(position, allpieces);
+#elif defined(USE_KINDERGARTEN)
+        auto a = getDiagonalAntiDiagonalKindergarten(position, allpieces);
+#elif defined(USE_MAGIC)
+        auto a = getDiagonalAntiDiagonalMagic(position, allpieces);
+#else
+        auto a = getDiagonalAntiDiagonalPext(position, allpieces);
+#endif
         BENCH(Times::getInstance().stop("getDiagonalAntiDiagonal"))
         return a;
     }
 
+    static inline u64 getRankFileKindergarten(const int position, const u64 allpieces) {
+        return (BITBOARD_FILE[position][fileIdx(position, allpieces)]) |
+               BITBOARD_RANK[position][rankIdx(position, allpieces)];
+    }
+
+    static inline u64 getDiagonalAntiDiagonalKindergarten(const int position, const u64 allpieces) {
+        return BITBOARD_DIAGONAL[position][diagonalIdx(position, allpieces)] |
+               BITBOARD_ANTIDIAGONAL[position][antiDiagonalIdx(position, allpieces)];
+    }
+
+    static inline u64 getRankFileMagic(const int position, const u64 allpieces) {
+        const _Tmagic &m = ROOK_MAGIC[position];
+        return m.attacks[((allpieces & m.mask) * m.magic) >> m.shift];
+    }
+
+    static inline u64 getDiagonalAntiDiagonalMagic(const int position, const u64 allpieces) {
+        const _Tmagic &m = BISHOP_MAGIC[position];
+        return m.attacks[((allpieces & m.mask) * m.magic) >> m.shift];
+    }
+
+#ifdef PEXT_BACKEND
+
+    // without bmi2 in the -m flags only if the cpu has it
+    static inline u64 pext(const u64 bits, const u64 mask) {
+#if defined(USE_BMI2) || defined(__BMI2__)
+        return _pext_u64(bits, mask);
+#else
+        u64 res;
+        __asm__("pextq %2, %1, %0": "=r"(res): "r"(bits), "rm"(mask));
+        return res;
+#endif
+    }
+
+    static inline u64 getRankFilePext(const int position, const u64 allpieces) {
+        const _Tmagic &m = ROOK_MAGIC[position];
+        return m.pextAttacks[pext(allpieces, m.mask)];
+    }
+
+    static inline u64 getDiagonalAntiDiagonalPext(const int position, const u64 allpieces) {
+        const _Tmagic &m = BISHOP_MAGIC[position];
+        return m.pextAttacks[pext(allpieces, m.mask)];
+    }
+
+#endif
+
 private:
 
+    // relevant occupancy of a square (the line without the edges) and its slice of the shared tables
+    typedef struct {
+        u64 mask;
+        u64 magic;
+        u64 *attacks;
+        u64 *pextAttacks;
+        unsigned shift;
+    } _Tmagic;
+
+    static constexpr int ROOK_TABLE_SIZE = 102400;
+    static constexpr int BISHOP_TABLE_SIZE = 5248;
+
+    static _Tmagic ROOK_MAGIC[64];
+    static _Tmagic BISHOP_MAGIC[64];
+    static u64 ROOK_ATTACKS[ROOK_TABLE_SIZE];
+    static u64 BISHOP_ATTACKS[BISHOP_TABLE_SIZE];
+#ifdef PEXT_BACKEND
+    static u64 ROOK_PEXT[ROOK_TABLE_SIZE];
+    static u64 BISHOP_PEXT[BISHOP_TABLE_SIZE];
+#endif
+
     constexpr static u64 MAGIC_KEY_DIAG_ANTIDIAG = 0x101010101010101ULL;
     constexpr static u64 MAGIC_KEY_FILE_RANK = 0x102040810204080ULL;
 
@@ -151,6 +271,8 @@ private:
 
     void popolateRank();
 
+    static void popolateMagic(_Tmagic *magics, u64 *attacks, u64 *pextAttacks, const bool rook);
+
     u64 performRankShift(const int position, const u64 allpieces);
 
     static u64 performColumnCapture(const int position, const u64 allpieces);
@@ -159,6 +281,7 @@ private:
 
     u64 performColumnShift(const int position, const u64 allpieces);
 
+    static _Tslider slider;
     static mutex mutexConstructor;
     static bool volatile generated;
 };
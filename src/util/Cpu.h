@@ -0,0 +1,106 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// x86-64 builds carry the kernels of the extensions not enabled by the -m flags and select them at startup
+// with cpuid. popcnt and pext are inline asm, so they stay inlined in a build without the extension (the
+// assembler takes them whatever the -m flags); the NNUE kernels are functions with a target attribute
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(JS_MODE)
+#define CPU_DISPATCH
+#define TARGET(a) __attribute__((target(a)))
+#endif
+
+#ifdef CPU_DISPATCH
+
+#include <cpuid.h>
+#include <cstring>
+#include <string>
+
+using std::string;
+
+/**
+ * cpuid, the features are read by libgcc before main
+ */
+class Cpu {
+public:
+
+    static bool hasPopcnt() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("popcnt");
+    }
+
+    static bool hasSse41() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.1");
+    }
+
+    static bool hasAvx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+
+    static bool hasBmi2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2");
+    }
+
+    // pext is microcoded on AMD before Zen 3 (family 19h)
+    static bool isSlowPext() {
+        __builtin_cpu_init();
+        return __builtin_cpu_is("amd") && getFamily() < 0x19;
+    }
+
+    static int getFamily() {
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0;
+        const int family = (eax >> 8) & 0xf;
+        return family == 0xf ? family + ((eax >> 20) & 0xff) : family;
+    }
+
+    static string getName() {
+        unsigned regs[12];
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000004) return "unknown cpu";
+        for (unsigned i = 0; i < 3; i++) {
+            __get_cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+        }
+        char name[sizeof(regs) + 1];
+        memcpy(name, regs, sizeof(regs));
+        name[sizeof(regs)] = 0;
+        string res(name);
+        res.erase(0, res.find_first_not_of(' '));
+        return res;
+    }
+
+    static string getFeatures() {
+        string res;
+        if (hasPopcnt()) res += "popcnt ";
+        if (hasSse41()) res += "sse4.1 ";
+        if (hasAvx2()) res += "avx2 ";
+        if (hasBmi2()) res += isSlowPext() ? "bmi2(slow pext) " : "bmi2 ";
+        return res;
+    }
+};
+
+#if !defined(HAS_POPCNT) && !defined(__POPCNT__)
+// read once at startup in each translation unit. Before that (static initialization of another unit)
+// it is false and bitCount takes the portable loop
+static const bool CPU_HAS_POPCNT = Cpu::hasPopcnt();
+#endif
+
+#endif
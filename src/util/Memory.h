@@ -0,0 +1,263 @@
+/*
+    Cinnamon UCI chess engine
+    Copyright (C) Giuseppe Cannella
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "../namespaces/bits.h"
+
+#if defined(__linux__) && !defined(JS_MODE)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+
+#define HAS_MMAP
+#endif
+
+using namespace std;
+
+// large tables (transposition table, perft hash) are allocated here: explicit huge pages
+// (MAP_HUGETLB), transparent huge pages (MADV_HUGEPAGE) or calloc, the memory is always zeroed
+class Memory {
+public:
+
+    enum : int {
+        ALLOC_NONE = 0, ALLOC_CALLOC = 1, ALLOC_MADVISE = 2, ALLOC_HUGETLB = 3, ALLOC_SHARED = 4
+    };
+
+    typedef struct {
+        void *ptr;
+        void *raw;
+        u64 size;
+        int type;
+        string name;    // shared memory object
+    } _Tmemory;
+
+    // start of a shared memory object: the creator publishes it when the content is initialized,
+    // the attached processes are counted
+    typedef struct alignas(64) {
+        atomic<unsigned> ready;
+        atomic<int> attached;
+    } _TsharedHeader;
+
+    static bool &largePages() {
+        static bool b = true;
+        return b;
+    }
+
+    static const char *getTypeName(const int type) {
+        static const char *names[] = {"none", "calloc", "madvise(MADV_HUGEPAGE)", "mmap(MAP_HUGETLB)",
+                                      "shared memory"};
+        return names[type];
+    }
+
+    static bool alloc(_Tmemory &mem, const u64 size, const u64 alignment = 64) {
+        mem.ptr = mem.raw = nullptr;
+        mem.size = 0;
+        mem.type = ALLOC_NONE;
+        mem.name.clear();
+#ifdef HAS_MMAP
+        if (largePages() && size >= HUGE_PAGE) {
+            const u64 hugeSize = (size + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+#ifdef MAP_HUGETLB
+            void *p = mmap(nullptr, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED) {
+                mem.ptr = mem.raw = p;
+                mem.size = hugeSize;
+                mem.type = ALLOC_HUGETLB;
+                return true;
+            }
+#endif
+#ifdef MADV_HUGEPAGE
+            // over-map and trim so that the table starts on a huge page boundary
+            void *q = mmap(nullptr, hugeSize + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (q != MAP_FAILED) {
+                const uintptr_t start = (uintptr_t) q;
+                const uintptr_t aligned = (start + HUGE_PAGE - 1) & ~(uintptr_t) (HUGE_PAGE - 1);
+                if (aligned > start) {
+                    munmap(q, aligned - start);
+                }
+                if (start + HUGE_PAGE > aligned) {
+                    munmap((void *) (aligned + hugeSize), start + HUGE_PAGE - aligned);
+                }
+                mem.ptr = mem.raw = (void *) aligned;
+                mem.size = hugeSize;
+                if (madvise(mem.ptr, hugeSize, MADV_HUGEPAGE) == 0) {
+                    mem.type = ALLOC_MADVISE;
+                    return true;
+                }
+                munmap(mem.ptr, hugeSize);
+                mem.ptr = mem.raw = nullptr;
+                mem.size = 0;
+            }
+#endif
+        }
+#endif
+        mem.raw = calloc(size + alignment, 1);
+        if (!mem.raw) {
+            return false;
+        }
+        mem.ptr = (void *) (((uintptr_t) mem.raw + alignment - 1) & ~(uintptr_t) (alignment - 1));
+        mem.size = size;
+        mem.type = ALLOC_CALLOC;
+        return true;
+    }
+
+    /**
+     * attaches the POSIX shared memory object 'name' (ptr, size bytes after the _TsharedHeader).
+     * If it doesn't exist it is created with 'size' bytes and zeroed, the creator initializes the content and
+     * calls publishShared. Otherwise the size of the existing object is used, waiting for the creator to size
+     * and publish it.
+     * Lifecycle: dealloc and detachShared count down the attached processes, the last one removes the name.
+     * An object whose count already reached 0 is being removed: it is not attached, the creation is retried.
+     * A process killed without detaching never counts down, so the name outlives every engine (the next ones
+     * attach to it) until unlinkShared removes it
+     */
+    static bool allocShared(_Tmemory &mem, const string &name, const u64 size, bool &created) {
+        mem.ptr = mem.raw = nullptr;
+        mem.size = 0;
+        mem.type = ALLOC_NONE;
+        mem.name.clear();
+        created = false;
+#ifdef HAS_MMAP
+        const string shmName = getSharedName(name);
+        for (int retry = 0; retry < SHARED_WAIT_MS; retry++) {
+            int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd != -1) {
+                created = true;
+                if (ftruncate(fd, size + sizeof(_TsharedHeader))) {
+                    close(fd);
+                    shm_unlink(shmName.c_str());
+                    return false;
+                }
+            } else {
+                fd = shm_open(shmName.c_str(), O_RDWR, 0600);
+                if (fd == -1) {
+                    // removed after the O_EXCL create failed
+                    if (errno == ENOENT) continue;
+                    return false;
+                }
+            }
+            // between shm_open and ftruncate of the creator the size is 0
+            struct stat info;
+            for (int i = 0; !fstat(fd, &info) && !info.st_size && i < SHARED_WAIT_MS; i++) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+            if (fstat(fd, &info) || (u64) info.st_size <= sizeof(_TsharedHeader)) {
+                close(fd);
+                return false;
+            }
+            void *p = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) {
+                return false;
+            }
+            _TsharedHeader *header = (_TsharedHeader *) p;
+            if (created) {
+                header->attached.store(1);
+            } else {
+                for (int i = 0; header->ready.load(memory_order_acquire) != SHARED_READY && i < SHARED_WAIT_MS; i++) {
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                }
+                if (header->ready.load(memory_order_acquire) != SHARED_READY) {
+                    munmap(p, info.st_size);
+                    return false;
+                }
+                // never from 0: the last process detached and is removing the name
+                int n = header->attached.load();
+                while (n > 0 && !header->attached.compare_exchange_weak(n, n + 1));
+                if (!n) {
+                    munmap(p, info.st_size);
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                    continue;
+                }
+            }
+            mem.raw = p;
+            mem.ptr = (char *) p + sizeof(_TsharedHeader);
+            mem.size = info.st_size - sizeof(_TsharedHeader);
+            mem.type = ALLOC_SHARED;
+            mem.name = shmName;
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    static void publishShared(_Tmemory &mem) {
+        if (mem.type == ALLOC_SHARED) {
+            ((_TsharedHeader *) mem.raw)->ready.store(SHARED_READY, memory_order_release);
+        }
+    }
+
+    // the memory stays mapped, the last process attached removes the name
+    static void detachShared(_Tmemory &mem) {
+#ifdef HAS_MMAP
+        if (mem.type == ALLOC_SHARED && !mem.name.empty()) {
+            if (((_TsharedHeader *) mem.raw)->attached.fetch_sub(1) == 1) {
+                shm_unlink(mem.name.c_str());
+            }
+            mem.name.clear();
+        }
+#endif
+    }
+
+    // removes the name even if some processes are attached, they keep their mapping
+    static bool unlinkShared(const string &name) {
+#ifdef HAS_MMAP
+        return !name.empty() && !shm_unlink(getSharedName(name).c_str());
+#else
+        return false;
+#endif
+    }
+
+    static void dealloc(_Tmemory &mem) {
+#ifdef HAS_MMAP
+        if (mem.type == ALLOC_SHARED) {
+            detachShared(mem);
+            munmap(mem.raw, mem.size + sizeof(_TsharedHeader));
+        }
+        if (mem.type == ALLOC_HUGETLB || mem.type == ALLOC_MADVISE) {
+            munmap(mem.raw, mem.size);
+        }
+#endif
+        if (mem.type == ALLOC_CALLOC) {
+            free(mem.raw);
+        }
+        mem.ptr = mem.raw = nullptr;
+        mem.size = 0;
+        mem.type = ALLOC_NONE;
+    }
+
+private:
+    static constexpr u64 HUGE_PAGE = 2 * 1024 * 1024;
+    static constexpr unsigned SHARED_READY = 0x534e4943;
+    static constexpr int SHARED_WAIT_MS = 10000;
+
+    static string getSharedName(const string &name) {
+        return name[0] == '/' ? name : "/" + name;
+    }
+};